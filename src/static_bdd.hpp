@@ -0,0 +1,289 @@
+#ifndef STATIC_BDD_HPP
+#define STATIC_BDD_HPP
+
+// Compile-time BDDs for Boolean functions fixed at build time (C++17).
+// BDD_create parses and reduces the function by constexpr evaluation, so a
+// static rule is a frozen node array with no startup cost:
+//
+//   constexpr auto built = static_bdd::BDD_create<64>("AB+C", "ABC");
+//   constexpr auto rule = static_bdd::BDD_freeze<built.count>(built);
+//   static_assert(static_bdd::BDD_use(rule, "001") == '1');
+//
+// Functions use the syntax and variable numbering of the runtime BDD_create
+// (product terms of letters joined by '+', lowercase letters name the same
+// variables), and BDD_use evaluates like the runtime one. Errors that the
+// runtime reports on stderr stop the compilation instead
+
+namespace static_bdd {
+
+// Node of a static BDD - children are indices into the node array, where 0
+// and 1 are the terminals
+struct Node {
+  int var;  // Level (-1 for terminal nodes)
+  int low;  // Child for variable = 0 (the value of a terminal node)
+  int high; // Child for variable = 1
+};
+
+// Static BDD with room for Capacity nodes, terminals included
+template <int Capacity> struct BDD {
+  Node nodes[Capacity] = {};
+  int count = 0;    // Nodes in use, reachable from the root once built
+  int size = 0;     // Number of internal nodes, as in the runtime BDD
+  int root = 0;     // Root node
+  int num_vars = 0; // Number of variables
+  char var_order[27] = {}; // Variable ordering
+};
+
+namespace detail {
+
+constexpr int string_length(const char *text) {
+  int length = 0;
+  while (text[length] != '\0') {
+    length++;
+  }
+  return length;
+}
+
+// Variable index of a letter (-1 for other characters)
+constexpr int letter_index(char name) {
+  if (name >= 'A' && name <= 'Z')
+    return name - 'A';
+  if (name >= 'a' && name <= 'z')
+    return name - 'a';
+  return -1;
+}
+
+// Count variables in a Boolean function
+constexpr int count_variables(const char *bfunkcia) {
+  int max_var = -1;
+  for (int i = 0; bfunkcia[i] != '\0'; i++) {
+    if (letter_index(bfunkcia[i]) > max_var)
+      max_var = letter_index(bfunkcia[i]);
+  }
+  return max_var + 1;
+}
+
+// Node array under construction with its unique table (a linear search -
+// static rules are small) and a lossy computed table for OR
+template <int Capacity> struct Builder {
+  static constexpr int CacheSize = 2 * Capacity;
+
+  Node nodes[Capacity] = {};
+  int count = 0;
+  int cache_f[CacheSize] = {};
+  int cache_g[CacheSize] = {};
+  int cache_result[CacheSize] = {};
+
+  constexpr Builder() {
+    static_assert(Capacity >= 2, "A static BDD needs room for the terminals");
+    nodes[0] = {-1, 0, 0};
+    nodes[1] = {-1, 1, 1};
+    count = 2;
+  }
+
+  // Find or add a node, applying the reduction rules
+  constexpr int find_or_add_node(int var, int low, int high) {
+    if (low == high)
+      return low;
+
+    for (int i = 2; i < count; i++) {
+      if (nodes[i].var == var && nodes[i].low == low &&
+          nodes[i].high == high)
+        return i;
+    }
+
+    if (count == Capacity)
+      throw "Node limit exceeded";
+    nodes[count] = {var, low, high};
+    return count++;
+  }
+
+  // OR of two nodes
+  constexpr int apply_or(int f, int g) {
+    // Terminal cases
+    if (f == 1 || g == 1)
+      return 1;
+    if (f == 0 || f == g)
+      return g;
+    if (g == 0)
+      return f;
+
+    if (f > g) {
+      int swap = f;
+      f = g;
+      g = swap;
+    }
+
+    int slot = (f * 31 + g) % CacheSize;
+    if (cache_result[slot] != 0 && cache_f[slot] == f && cache_g[slot] == g)
+      return cache_result[slot];
+
+    int var = nodes[f].var < nodes[g].var ? nodes[f].var : nodes[g].var;
+    int f_low = nodes[f].var == var ? nodes[f].low : f;
+    int f_high = nodes[f].var == var ? nodes[f].high : f;
+    int g_low = nodes[g].var == var ? nodes[g].low : g;
+    int g_high = nodes[g].var == var ? nodes[g].high : g;
+
+    int low = apply_or(f_low, g_low);
+    int high = apply_or(f_high, g_high);
+    int result = find_or_add_node(var, low, high);
+
+    cache_f[slot] = f;
+    cache_g[slot] = g;
+    cache_result[slot] = result;
+    return result;
+  }
+
+  // Create the node of one product term (the characters up to length)
+  constexpr int create_term(const char *term, int length, const char *order,
+                            int num_vars) {
+    bool positive[26] = {};
+    for (int i = 0; i < length; i++) {
+      int var_idx = letter_index(term[i]);
+      if (var_idx < 0)
+        continue;
+
+      int level = 0;
+      while (level < num_vars && letter_index(order[level]) != var_idx) {
+        level++;
+      }
+      if (level == num_vars)
+        throw "Variable is missing from the ordering";
+      positive[level] = true;
+    }
+
+    // Build the path from bottom up
+    int curr = 1;
+    for (int level = num_vars - 1; level >= 0; level--) {
+      if (positive[level])
+        curr = find_or_add_node(level, 0, curr);
+    }
+    return curr;
+  }
+};
+
+} // namespace detail
+
+// Create a static BDD for a Boolean function with a variable ordering. The
+// node array keeps only the nodes reachable from the root, children first
+template <int Capacity>
+constexpr BDD<Capacity> BDD_create(const char *bfunkcia, const char *poradie) {
+  int num_vars = detail::count_variables(bfunkcia);
+  if (detail::string_length(poradie) < num_vars)
+    throw "Variable ordering has insufficient variables";
+
+  // Build the BDD
+  detail::Builder<Capacity> builder;
+  int root = 0;
+  int i = 0;
+  while (bfunkcia[i] != '\0') {
+    // Process one product term
+    int start = i;
+    while (bfunkcia[i] != '\0' && bfunkcia[i] != '+') {
+      i++;
+    }
+    root = builder.apply_or(
+        root, builder.create_term(bfunkcia + start, i - start, poradie,
+                                  num_vars));
+
+    // Skip the '+' separator
+    if (bfunkcia[i] == '+') {
+      i++;
+    }
+  }
+
+  // Keep the reachable nodes - children always have lower indices than
+  // their parents, so a backward sweep marks them all
+  bool reachable[Capacity] = {};
+  reachable[root] = true;
+  for (int node = builder.count - 1; node >= 2; node--) {
+    if (reachable[node]) {
+      reachable[builder.nodes[node].low] = true;
+      reachable[builder.nodes[node].high] = true;
+    }
+  }
+
+  BDD<Capacity> bdd;
+  int index[Capacity] = {};
+  bdd.nodes[0] = builder.nodes[0];
+  bdd.nodes[1] = builder.nodes[1];
+  index[1] = 1;
+  bdd.count = 2;
+  for (int node = 2; node < builder.count; node++) {
+    if (!reachable[node])
+      continue;
+
+    Node kept = builder.nodes[node];
+    kept.low = index[kept.low];
+    kept.high = index[kept.high];
+    index[node] = bdd.count;
+    bdd.nodes[bdd.count++] = kept;
+  }
+
+  bdd.size = bdd.count - 2;
+  bdd.root = index[root];
+  bdd.num_vars = num_vars;
+
+  // Copy the variable ordering
+  int length = detail::string_length(poradie);
+  for (int j = 0; j < length && j < 26; j++) {
+    bdd.var_order[j] = poradie[j];
+  }
+
+  return bdd;
+}
+
+// Copy a static BDD into an array of exactly Size nodes (its count)
+template <int Size, int Capacity>
+constexpr BDD<Size> BDD_freeze(const BDD<Capacity> &bdd) {
+  if (bdd.count > Size)
+    throw "Node limit exceeded";
+
+  BDD<Size> frozen;
+  for (int i = 0; i < bdd.count; i++) {
+    frozen.nodes[i] = bdd.nodes[i];
+  }
+  frozen.count = bdd.count;
+  frozen.size = bdd.size;
+  frozen.root = bdd.root;
+  frozen.num_vars = bdd.num_vars;
+  for (int i = 0; i < 27; i++) {
+    frozen.var_order[i] = bdd.var_order[i];
+  }
+
+  return frozen;
+}
+
+// Evaluate a static BDD for the inputs ('0' or '1' for each variable, indexed
+// by letter). Returns '0' or '1', -1 for invalid inputs
+template <int Capacity>
+constexpr char BDD_use(const BDD<Capacity> &bdd, const char *vstupy) {
+  if (!vstupy)
+    return -1;
+
+  int length = detail::string_length(vstupy);
+  int current = bdd.root;
+
+  // Traverse the BDD
+  while (bdd.nodes[current].var != -1) {
+    int input_idx = bdd.var_order[bdd.nodes[current].var] - 'A';
+    if (input_idx < 0 || input_idx >= length)
+      return -1; // Error: input index out of bounds
+
+    char input_value = vstupy[input_idx];
+    if (input_value == '0') {
+      current = bdd.nodes[current].low;
+    } else if (input_value == '1') {
+      current = bdd.nodes[current].high;
+    } else {
+      return -1; // Error: invalid input value
+    }
+  }
+
+  // Return the terminal value
+  return '0' + bdd.nodes[current].low;
+}
+
+} // namespace static_bdd
+
+#endif // STATIC_BDD_HPP
@@ -8,10 +8,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <fcntl.h>
 #include <limits.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdint.h>
 #include <string.h>
+#include <sys/file.h>
 #include <time.h>
+#include <unistd.h>
 
 // Node in the BDD
 typedef struct Node {
@@ -22,12 +27,21 @@ typedef struct Node {
   struct Node *next; // For unique table
 } Node;
 
+// Balanced OR tree over the product terms of a BDD, stored as an array
+// (leaves hold the term BDDs, each inner node the OR of its two children)
+typedef struct TermTree {
+  Node **nodes;  // nodes[1] is the root, leaves start at nodes[capacity]
+  int capacity;  // Number of leaves (a power of two)
+  int count;     // Number of leaves holding a term
+} TermTree;
+
 // BDD structure
 typedef struct BDD {
   int num_vars;    // Number of variables
   int size;        // Number of nodes
   Node *root;      // Root node
   char *var_order; // Variable ordering
+  TermTree *terms; // Terms the root is built from (NULL if not editable)
 } BDD;
 
 // Unique table for nodes
@@ -40,6 +54,143 @@ typedef struct {
 // Global unique table
 UniqueTable unique_table;
 
+// Operations memoized in the computed table
+enum {
+  OP_OR,
+  OP_AND,
+  OP_RESTRICT,
+  OP_EXISTS,
+  OP_FORALL,
+  OP_AND_EXISTS,
+  OP_NOT,
+  OP_ZDD_UNION,
+  OP_ZDD_INTERSECT,
+  OP_ZDD_DIFF,
+  OP_ZDD_PRODUCT
+};
+
+// Computed table entry - result of op applied to (f, g, h)
+typedef struct {
+  unsigned seq; // Odd while a writer fills the entry
+  int op;
+  Node *f;
+  Node *g;
+  Node *h;
+  Node *result; // NULL for an empty slot
+} CacheEntry;
+
+// Computed table (direct-mapped, a colliding insert overwrites the slot).
+// Entries are guarded by their sequence number, so parallel apply can use
+// the table without locks - a torn or busy entry reads as a miss and a
+// contended insert is dropped
+typedef struct {
+  CacheEntry *entries;
+  int size;
+} ComputedTable;
+
+// Global computed table
+ComputedTable computed_table;
+
+// Initialize the computed table, dropping all cached results. If the new
+// table cannot be allocated the old one is emptied and kept (without any,
+// operations simply run uncached)
+void init_computed_table(int size) {
+  CacheEntry *entries = (CacheEntry *)calloc(size, sizeof(CacheEntry));
+  if (!entries) {
+    if (computed_table.entries != NULL) {
+      memset(computed_table.entries, 0,
+             computed_table.size * sizeof(CacheEntry));
+    }
+    return;
+  }
+
+  free(computed_table.entries);
+  computed_table.size = size;
+  computed_table.entries = entries;
+}
+
+// Hash function for the computed table
+int hash_operation(int op, Node *f, Node *g, Node *h) {
+  unsigned long hash = (unsigned long)op * 7 + (unsigned long)f * 1009 +
+                       (unsigned long)g * 10007 + (unsigned long)h * 100003;
+  return (int)(hash % computed_table.size);
+}
+
+// Look up a cached result (NULL if not present)
+Node *cache_lookup(int op, Node *f, Node *g, Node *h) {
+  if (computed_table.entries == NULL)
+    return NULL;
+
+  CacheEntry *entry = &computed_table.entries[hash_operation(op, f, g, h)];
+  unsigned seq = __atomic_load_n(&entry->seq, __ATOMIC_ACQUIRE);
+  if (seq & 1)
+    return NULL; // Being written
+
+  int entry_op = __atomic_load_n(&entry->op, __ATOMIC_RELAXED);
+  Node *entry_f = __atomic_load_n(&entry->f, __ATOMIC_RELAXED);
+  Node *entry_g = __atomic_load_n(&entry->g, __ATOMIC_RELAXED);
+  Node *entry_h = __atomic_load_n(&entry->h, __ATOMIC_RELAXED);
+  Node *result = __atomic_load_n(&entry->result, __ATOMIC_RELAXED);
+
+  // The entry was overwritten while we read it
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  if (__atomic_load_n(&entry->seq, __ATOMIC_RELAXED) != seq)
+    return NULL;
+
+  if (result != NULL && entry_op == op && entry_f == f && entry_g == g &&
+      entry_h == h) {
+    return result;
+  }
+  return NULL;
+}
+
+// Store a result in the computed table
+void cache_insert(int op, Node *f, Node *g, Node *h, Node *result) {
+  if (computed_table.entries == NULL)
+    return;
+
+  CacheEntry *entry = &computed_table.entries[hash_operation(op, f, g, h)];
+
+  // Claim the entry, giving up if another thread is writing it
+  unsigned seq = __atomic_load_n(&entry->seq, __ATOMIC_RELAXED);
+  if ((seq & 1) ||
+      !__atomic_compare_exchange_n(&entry->seq, &seq, seq + 1, 0,
+                                   __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+    return;
+  }
+
+  __atomic_store_n(&entry->op, op, __ATOMIC_RELAXED);
+  __atomic_store_n(&entry->f, f, __ATOMIC_RELAXED);
+  __atomic_store_n(&entry->g, g, __ATOMIC_RELAXED);
+  __atomic_store_n(&entry->h, h, __ATOMIC_RELAXED);
+  __atomic_store_n(&entry->result, result, __ATOMIC_RELAXED);
+  __atomic_store_n(&entry->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+// Resize the computed table, moving every cached result into its slot in
+// the new one (of two results that land in one slot, one is dropped). Only
+// safe while no parallel apply runs. Keeps the old table if the new one
+// cannot be allocated
+void resize_computed_table(int size) {
+  CacheEntry *entries = (CacheEntry *)calloc(size, sizeof(CacheEntry));
+  if (!entries)
+    return;
+
+  CacheEntry *old = computed_table.entries;
+  int old_size = computed_table.size;
+  computed_table.entries = entries;
+  computed_table.size = size;
+  for (int i = 0; i < old_size; i++) {
+    if (old[i].result != NULL) {
+      CacheEntry *entry = &entries[hash_operation(old[i].op, old[i].f,
+                                                  old[i].g, old[i].h)];
+      *entry = old[i];
+      entry->seq = 0;
+    }
+  }
+  free(old);
+}
+
 // Initialize the unique table
 void init_unique_table(int size) {
   if (unique_table.buckets != NULL) {
@@ -48,6 +199,12 @@ void init_unique_table(int size) {
   unique_table.size = size;
   unique_table.count = 0;
   unique_table.buckets = (Node **)calloc(size, sizeof(Node *));
+  if (!unique_table.buckets) {
+    fprintf(stderr, "Memory allocation failed for unique table\n");
+  }
+
+  // Cached results refer to nodes of the previous table
+  init_computed_table(size);
 }
 
 // Hash function for the unique table
@@ -61,12 +218,16 @@ int hash_node(int var, Node *low, Node *high) {
 Node *zero_terminal = NULL;
 Node *one_terminal = NULL;
 
-// Create a terminal node
+// Create a terminal node (NULL if it cannot be allocated)
 Node *create_terminal(int value) {
 
   if (value == 0) {
     if (zero_terminal == NULL) {
       zero_terminal = (Node *)malloc(sizeof(Node));
+      if (!zero_terminal) {
+        fprintf(stderr, "Memory allocation failed for terminal node\n");
+        return NULL;
+      }
       zero_terminal->var = -1;
       zero_terminal->low = zero_terminal->high = NULL;
       zero_terminal->value = 0;
@@ -76,6 +237,10 @@ Node *create_terminal(int value) {
   } else {
     if (one_terminal == NULL) {
       one_terminal = (Node *)malloc(sizeof(Node));
+      if (!one_terminal) {
+        fprintf(stderr, "Memory allocation failed for terminal node\n");
+        return NULL;
+      }
       one_terminal->var = -1;
       one_terminal->low = one_terminal->high = NULL;
       one_terminal->value = 1;
@@ -85,7 +250,124 @@ Node *create_terminal(int value) {
   }
 }
 
-// Find or add a node to the unique table
+// Largest number of nodes the unique table may hold (0 = no limit). Checked
+// against the published count, so parallel apply may overshoot it by up to
+// NODE_COUNT_BATCH nodes per thread
+int node_limit = 0;
+
+// Nodes a thread adds during a parallel apply before publishing them in the
+// table's count, so the threads do not all contend on one counter
+#define NODE_COUNT_BATCH 64
+
+int pool_running = 0;           // A parallel apply is in progress
+__thread int pending_nodes = 0; // Nodes added but not yet counted
+
+// Publish the nodes the calling thread added to the table's count
+void flush_node_count() {
+  if (pending_nodes > 0) {
+    __atomic_fetch_add(&unique_table.count, pending_nodes, __ATOMIC_RELAXED);
+    pending_nodes = 0;
+  }
+}
+
+// Double the buckets of the unique table once it holds more than two nodes
+// per bucket, and the computed table with them. Relinking the chains is only
+// safe while no parallel apply runs, so it is never called from one
+void grow_unique_table() {
+  if (unique_table.count <= 2 * unique_table.size)
+    return;
+
+  int size = unique_table.size * 2;
+  Node **buckets = (Node **)calloc(size, sizeof(Node *));
+  if (!buckets)
+    return; // Keep the longer chains
+
+  Node **old = unique_table.buckets;
+  int old_size = unique_table.size;
+  unique_table.size = size;
+  for (int i = 0; i < old_size; i++) {
+    Node *p = old[i];
+    while (p != NULL) {
+      Node *next = p->next;
+      int hash = hash_node(p->var, p->low, p->high);
+      p->next = buckets[hash];
+      buckets[hash] = p;
+      p = next;
+    }
+  }
+  free(old);
+  unique_table.buckets = buckets;
+
+  // Cached results stay valid - a larger table just keeps more of them
+  resize_computed_table(size);
+}
+
+// Set the node budget of the unique table (0 = no limit). Operations that
+// would exceed it fail and return NULL (or -1) instead of growing the table,
+// without printing anything - running out of budget is an expected outcome
+void BDD_set_node_limit(int nodes) { node_limit = nodes > 0 ? nodes : 0; }
+
+// Find or add the node (var, low, high) in the unique table without applying
+// any reduction rule. Returns NULL if a new node would exceed the node budget
+// or cannot be allocated
+Node *unique_node(int var, Node *low, Node *high) {
+  int hash = hash_node(var, low, high);
+  Node **bucket = &unique_table.buckets[hash];
+  Node *head = __atomic_load_n(bucket, __ATOMIC_ACQUIRE);
+  Node *seen = NULL; // Nodes from here on were already searched
+  Node *newNode = NULL;
+
+  // Nodes are only ever prepended with a CAS on the bucket and never change
+  // once published, so parallel apply can share the table without locks
+  for (;;) {
+    // Look for an existing node
+    for (Node *p = head; p != seen; p = p->next) {
+      if (p->var == var && p->low == low && p->high == high) {
+        free(newNode); // Another thread added it first
+        return p;
+      }
+    }
+
+    // Create a new node
+    if (newNode == NULL) {
+      if (node_limit > 0 &&
+          __atomic_load_n(&unique_table.count, __ATOMIC_RELAXED) >=
+              node_limit) {
+        return NULL;
+      }
+      newNode = (Node *)malloc(sizeof(Node));
+      if (!newNode) {
+        return NULL;
+      }
+      newNode->var = var;
+      newNode->low = low;
+      newNode->high = high;
+      newNode->value = -1; // Not a terminal node
+    }
+
+    // Add to hash table
+    newNode->next = head;
+    seen = head;
+    if (__atomic_compare_exchange_n(bucket, &head, newNode, 0,
+                                    __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+      break;
+    }
+  }
+
+  if (__atomic_load_n(&pool_running, __ATOMIC_RELAXED)) {
+    if (++pending_nodes == NODE_COUNT_BATCH) {
+      flush_node_count();
+    }
+  } else {
+    __atomic_fetch_add(&unique_table.count, 1, __ATOMIC_RELAXED);
+    grow_unique_table();
+  }
+
+  return newNode;
+}
+
+// Find or add a BDD node to the unique table. Returns NULL if a new node would
+// exceed the node budget or cannot be allocated
 Node *find_or_add_node(int var, Node *low, Node *high) {
   // Apply reduction rules
 
@@ -95,30 +377,18 @@ Node *find_or_add_node(int var, Node *low, Node *high) {
     return low;
   }
 
-  int hash = hash_node(var, low, high);
-  Node *p = unique_table.buckets[hash];
+  return unique_node(var, low, high);
+}
 
-  // Look for an existing node
-  while (p != NULL) {
-    if (p->var == var && p->low == low && p->high == high) {
-      return p;
-    }
-    p = p->next;
+// Find or add a ZDD node to the unique table. ZDDs share the table with BDDs
+// but use the zero-suppression rule instead: a node whose high child is the
+// 0-terminal is skipped, while a node with equal children is kept
+Node *zdd_node(int var, Node *low, Node *high) {
+  if (high->var == -1 && high->value == 0) {
+    return low;
   }
 
-  // Create a new node
-  Node *newNode = (Node *)malloc(sizeof(Node));
-  newNode->var = var;
-  newNode->low = low;
-  newNode->high = high;
-  newNode->value = -1; // Not a terminal node
-
-  // Add to hash table
-  newNode->next = unique_table.buckets[hash];
-  unique_table.buckets[hash] = newNode;
-  unique_table.count++;
-
-  return newNode;
+  return unique_node(var, low, high);
 }
 
 // Count variables in a Boolean function
@@ -142,18 +412,6 @@ int count_variables(const char *bfunkcia) {
   return max_var + 1;
 }
 
-// Free the BDD
-void BDD_free(BDD *bdd) {
-  if (!bdd)
-    return;
-
-  if (bdd->var_order) {
-    free(bdd->var_order);
-  }
-
-  free(bdd);
-}
-
 // Evaluate a Boolean function for a given input
 int eval_boolean_function(const char *bfunkcia, const char *inputs) {
   int result = 0;
@@ -191,427 +449,3540 @@ int eval_boolean_function(const char *bfunkcia, const char *inputs) {
   return result;
 }
 
-// Create a BDD for a minterm (a single input combination that produces a 1)
-Node *create_minterm_bdd(int input_combination, int num_vars,
-                         const char *var_order) {
+// Create a BDD for a cube - values[level] is '1', '0', or anything else
+// for a level that does not occur in the cube. Returns NULL if the node
+// budget runs out
+Node *create_cube_node(const char *values, int num_vars) {
   Node *curr = create_terminal(1);
 
   // Build the path from bottom up
-  for (int i = num_vars - 1; i >= 0; i--) {
-    int var_idx = var_order[i] - 'A';
-    int bit_value = (input_combination >> var_idx) & 1;
-
-    if (bit_value == 0) {
-      curr = find_or_add_node(i, curr, create_terminal(0));
-    } else {
-      curr = find_or_add_node(i, create_terminal(0), curr);
+  for (int level = num_vars - 1; level >= 0 && curr != NULL; level--) {
+    if (values[level] == '1') {
+      curr = find_or_add_node(level, create_terminal(0), curr);
+    } else if (values[level] == '0') {
+      curr = find_or_add_node(level, curr, create_terminal(0));
     }
   }
 
   return curr;
 }
 
-// Apply operation (OR) between two BDDs
-Node *apply_or(Node *f, Node *g) {
-  // Terminal cases
-  if (f->var == -1 && g->var == -1) {
-    return create_terminal(f->value | g->value);
-  }
-
-  return (f->var == -1 && f->value == 1)   ? f
-         : (g->var == -1 && g->value == 1) ? g
-         : (f->var == -1 && f->value == 0) ? g
-         : (g->var == -1 && g->value == 0) ? f
-                                           : NULL;
+// Create a BDD for one product term (the characters up to length).
+// Returns NULL if the term uses a variable outside the ordering or the node
+// budget runs out
+Node *create_term_bdd(const char *term, int length, const char *var_order,
+                      int num_vars) {
+  char values[27] = {0}; // One entry per level (at most 26 variables)
+
+  for (int i = 0; i < length; i++) {
+    char name = term[i];
+    if (name >= 'a' && name <= 'z') {
+      name = name - 'a' + 'A';
+    } else if (name < 'A' || name > 'Z') {
+      continue;
+    }
 
-  // Determine the top variable
-  int var;
-  if (f->var == -1) {
-    var = g->var;
-  } else if (g->var == -1) {
-    var = f->var;
-  } else {
-    var = (f->var < g->var) ? f->var : g->var;
+    int level = 0;
+    while (level < num_vars && var_order[level] != name) {
+      level++;
+    }
+    if (level == num_vars) {
+      fprintf(stderr, "Variable %c is missing from the ordering\n", name);
+      return NULL;
+    }
+    values[level] = '1';
   }
 
-  // Extract children based on the top variable
-  Node *f_low = (f->var == var) ? f->low : f;
-  Node *f_high = (f->var == var) ? f->high : f;
-  Node *g_low = (g->var == var) ? g->low : g;
-  Node *g_high = (g->var == var) ? g->high : g;
-
-  // Recursive calls
-  Node *low_result = apply_or(f_low, g_low);
-  Node *high_result = apply_or(f_high, g_high);
-
-  // Create a new node and add to the unique table
-  return find_or_add_node(var, low_result, high_result);
+  return create_cube_node(values, num_vars);
 }
 
-// Build a BDD from a Boolean function and variable ordering
-Node *build_bdd(const char *bfunkcia, const char *var_order, int num_vars) {
-  // Initialize with the 0 function
-  Node *bdd = create_terminal(0);
+// How a frame builds its result from its children
+enum {
+  FRAME_JOIN,     // Node (var, low result, high result)
+  FRAME_ZDD_JOIN, // ZDD node (var, low result, high result)
+  FRAME_FORWARD,  // The low child is the result
+  FRAME_COMBINE   // The low and high results combined by combine_op
+};
 
-  // For each possible input combination
-  for (int i = 0; i < (1 << num_vars); i++) {
-    // Create input string
-    char *inputs = (char *)malloc(num_vars + 1);
-    if (!inputs) {
-      fprintf(stderr, "Memory allocation failed for inputs\n");
-      exit(1);
-    }
-
-    for (int j = 0; j < num_vars; j++) {
-      inputs[j] = ((i >> j) & 1) ? '1' : '0';
+// Frame of the explicit work stack - one pending operation
+typedef struct {
+  int op;           // Operation, as used in the computed table
+  Node *f;          // Operands (normalized once the frame is expanded)
+  Node *g;
+  Node *h;
+  int state;        // 0 = expand, 1 = low child done, 2 = high child done,
+                    // 3 = combination done
+  int kind;         // FRAME_JOIN, FRAME_ZDD_JOIN, FRAME_FORWARD or
+                    // FRAME_COMBINE
+  int cached;       // Store the result in the computed table when done
+  int var;          // Top variable of the operands
+  int child_op;     // Operation applied to both cofactor pairs
+  Node *child_f[2]; // Cofactor operands - [0] low, [1] high
+  Node *child_g[2];
+  Node *child_h[2];
+  int combine_op;   // OP_OR or OP_AND for FRAME_COMBINE
+} Frame;
+
+// Work stack of frames and finished results, reused by every operation
+typedef struct {
+  Frame *frames;
+  int frame_count;
+  int frame_capacity;
+  Node **values;
+  int value_count;
+  int value_capacity;
+} WorkStack;
+
+// Work stack of the calling thread (parallel apply workers finish their
+// tasks on their own stacks)
+__thread WorkStack work_stack;
+
+// Push a new operation onto the work stack. Returns -1 if the stack cannot
+// grow
+int push_frame(int op, Node *f, Node *g, Node *h) {
+  if (work_stack.frame_count == work_stack.frame_capacity) {
+    int capacity =
+        work_stack.frame_capacity ? work_stack.frame_capacity * 2 : 256;
+    Frame *frames =
+        (Frame *)realloc(work_stack.frames, capacity * sizeof(Frame));
+    if (!frames) {
+      fprintf(stderr, "Memory allocation failed for work stack\n");
+      return -1;
     }
-    inputs[num_vars] = '\0';
+    work_stack.frames = frames;
+    work_stack.frame_capacity = capacity;
+  }
 
-    // Evaluate the function for this input
-    int result = eval_boolean_function(bfunkcia, inputs);
+  Frame *frame = &work_stack.frames[work_stack.frame_count++];
+  frame->op = op;
+  frame->f = f;
+  frame->g = g;
+  frame->h = h;
+  frame->state = 0;
+  frame->cached = 0;
+  return 0;
+}
 
-    // If this input produces a 1, add the corresponding path to the BDD
-    if (result == 1) {
-      Node *minterm_bdd = create_minterm_bdd(i, num_vars, var_order);
-      bdd = apply_or(bdd, minterm_bdd);
+// Push a finished result onto the work stack. Returns -1 if the stack
+// cannot grow
+int push_value(Node *value) {
+  if (work_stack.value_count == work_stack.value_capacity) {
+    int capacity =
+        work_stack.value_capacity ? work_stack.value_capacity * 2 : 256;
+    Node **values =
+        (Node **)realloc(work_stack.values, capacity * sizeof(Node *));
+    if (!values) {
+      fprintf(stderr, "Memory allocation failed for work stack\n");
+      return -1;
     }
-
-    free(inputs);
+    work_stack.values = values;
+    work_stack.value_capacity = capacity;
   }
 
-  return bdd;
+  work_stack.values[work_stack.value_count++] = value;
+  return 0;
 }
 
-// Count the number of nodes in the BDD
-int count_nodes(Node *root, int *visited, int next_id) {
-  if (root == NULL)
-    return next_id;
-  if (root->var == -1)
-    return next_id; // Don't count terminal nodes
+// Free the work stack
+void free_work_stack() {
+  free(work_stack.frames);
+  free(work_stack.values);
+  work_stack.frames = NULL;
+  work_stack.values = NULL;
+  work_stack.frame_count = work_stack.frame_capacity = 0;
+  work_stack.value_count = work_stack.value_capacity = 0;
+}
 
-  // Check if already visited
-  for (int i = 0; i < next_id; i++) {
-    if (visited[i] == (int)(uintptr_t)root) {
-      return next_id;
-    }
-  }
+// Remainder of a cube below its top variable
+Node *cube_rest(Node *cube) {
+  return (cube->low->var == -1 && cube->low->value == 0) ? cube->high
+                                                         : cube->low;
+}
 
-  // Mark as visited
-  visited[next_id++] = (int)(uintptr_t)root;
+// Split both operands on the frame's top variable into the child operands
+void split_operands(Frame *frame, int child_op, Node *h_low, Node *h_high) {
+  Node *f = frame->f;
+  Node *g = frame->g;
+  int var = frame->var;
+
+  frame->child_op = child_op;
+  frame->child_f[0] = (f->var == var) ? f->low : f;
+  frame->child_f[1] = (f->var == var) ? f->high : f;
+  frame->child_g[0] = (g && g->var == var) ? g->low : g;
+  frame->child_g[1] = (g && g->var == var) ? g->high : g;
+  frame->child_h[0] = h_low;
+  frame->child_h[1] = h_high;
+}
 
-  // Recursively count children
-  next_id = count_nodes(root->low, visited, next_id);
-  next_id = count_nodes(root->high, visited, next_id);
+// Split both ZDD operands on the frame's top variable. A family that skips
+// the variable has no sets containing it, so its high cofactor is empty
+void split_zdd_operands(Frame *frame) {
+  Node *f = frame->f;
+  Node *g = frame->g;
+  int var = frame->var;
+
+  frame->child_op = frame->op;
+  frame->child_f[0] = (f->var == var) ? f->low : f;
+  frame->child_f[1] = (f->var == var) ? f->high : create_terminal(0);
+  frame->child_g[0] = (g->var == var) ? g->low : g;
+  frame->child_g[1] = (g->var == var) ? g->high : create_terminal(0);
+  frame->child_h[0] = frame->child_h[1] = NULL;
+}
 
-  return next_id;
+// Make the frame forward to a single other operation
+void forward_frame(Frame *frame, int op, Node *f, Node *g, Node *h) {
+  frame->kind = FRAME_FORWARD;
+  frame->child_op = op;
+  frame->child_f[0] = f;
+  frame->child_g[0] = g;
+  frame->child_h[0] = h;
 }
 
-// Create a BDD for a Boolean function with a given variable ordering
-BDD *BDD_create(const char *bfunkcia, const char *poradie) {
-  if (!bfunkcia || !poradie) {
-    fprintf(stderr, "Invalid input parameters\n");
-    return NULL;
+// Terminal and cached cases of a binary apply (OP_OR, OP_AND). Returns NULL
+// if the operands have to be split, with *f and *g put in canonical order
+Node *apply_shortcut(int op, Node **f_operand, Node **g_operand) {
+  Node *f = *f_operand;
+  Node *g = *g_operand;
+  int is_or = op == OP_OR;
+
+  // Terminal cases
+  if (f->var == -1 && g->var == -1) {
+    return create_terminal(is_or ? (f->value | g->value)
+                                 : (f->value & g->value));
   }
 
-  int num_vars = count_variables(bfunkcia);
-  if (strlen(poradie) < num_vars) {
-    fprintf(stderr, "Variable ordering has insufficient variables\n");
-    return NULL;
+  // The controlling value (1 for OR, 0 for AND) decides the result alone
+  if (f->var == -1) {
+    return f->value == is_or ? f : g;
+  }
+  if (g->var == -1) {
+    return g->value == is_or ? g : f;
+  }
+  if (f == g)
+    return f;
+
+  // OR and AND are commutative - order the operands so both orders share
+  // an entry
+  if (f > g) {
+    *f_operand = g;
+    *g_operand = f;
   }
 
-  // Initialize terminal nodes
-  zero_terminal = create_terminal(0);
-  one_terminal = create_terminal(1);
+  return cache_lookup(op, *f_operand, *g_operand, NULL);
+}
 
-  // Initialize unique table
-  init_unique_table(10000);
+// Expand a binary apply (OP_OR, OP_AND). Returns the result for the
+// terminal and cached cases, NULL once the frame has children to run
+Node *expand_apply(Frame *frame) {
+  Node *result = apply_shortcut(frame->op, &frame->f, &frame->g);
+  if (result)
+    return result;
+
+  frame->cached = 1;
+  frame->kind = FRAME_JOIN;
+  frame->var =
+      (frame->f->var < frame->g->var) ? frame->f->var : frame->g->var;
+  split_operands(frame, frame->op, NULL, NULL);
+  return NULL;
+}
 
-  // Build the BDD
-  Node *root = build_bdd(bfunkcia, poradie, num_vars);
+// Expand a cofactor by a cube (OP_RESTRICT, f = function, g = cube)
+Node *expand_restrict(Frame *frame) {
+  Node *f = frame->f;
+  Node *cube = frame->g;
 
-  // Create the BDD structure
-  BDD *bdd = (BDD *)malloc(sizeof(BDD));
-  if (!bdd) {
-    fprintf(stderr, "Memory allocation failed for BDD\n");
-    exit(1);
+  // Skip cube variables above the top of f - f does not depend on them
+  while (cube->var != -1 && (f->var == -1 || cube->var < f->var)) {
+    cube = cube_rest(cube);
+  }
+  if (f->var == -1 || cube->var == -1) {
+    return f;
   }
+  frame->g = cube;
+
+  Node *cached = cache_lookup(OP_RESTRICT, f, cube, NULL);
+  if (cached)
+    return cached;
+
+  frame->cached = 1;
+  frame->var = f->var;
+  if (f->var == cube->var) {
+    // Keep the branch selected by the literal
+    Node *branch = (cube->low->var == -1 && cube->low->value == 0) ? f->high
+                                                                   : f->low;
+    forward_frame(frame, OP_RESTRICT, branch, cube_rest(cube), NULL);
+  } else {
+    // The cube starts below f's top variable and passes to both children
+    frame->kind = FRAME_JOIN;
+    split_operands(frame, OP_RESTRICT, NULL, NULL);
+  }
+  return NULL;
+}
 
-  bdd->num_vars = num_vars;
-  bdd->root = root;
+// Expand a quantification (OP_EXISTS, OP_FORALL, f = function, g = cube)
+Node *expand_quantify(Frame *frame) {
+  Node *f = frame->f;
+  Node *cube = frame->g;
 
-  // Copy the variable ordering
-  bdd->var_order = (char *)malloc(strlen(poradie) + 1);
-  if (!bdd->var_order) {
-    fprintf(stderr, "Memory allocation failed for variable ordering\n");
-    free(bdd);
-    exit(1);
+  while (cube->var != -1 && (f->var == -1 || cube->var < f->var)) {
+    cube = cube_rest(cube);
+  }
+  if (f->var == -1 || cube->var == -1) {
+    return f;
   }
+  frame->g = cube;
+
+  Node *cached = cache_lookup(frame->op, f, cube, NULL);
+  if (cached)
+    return cached;
+
+  frame->cached = 1;
+  frame->var = f->var;
+  split_operands(frame, frame->op, NULL, NULL);
+  if (f->var == cube->var) {
+    // Quantified variable - combine the two cofactors
+    frame->kind = FRAME_COMBINE;
+    frame->combine_op = frame->op == OP_FORALL ? OP_AND : OP_OR;
+    frame->child_g[0] = frame->child_g[1] = cube_rest(cube);
+  } else {
+    frame->kind = FRAME_JOIN;
+  }
+  return NULL;
+}
 
-  strcpy(bdd->var_order, poradie);
+// Expand a relational product (OP_AND_EXISTS, h = cube)
+Node *expand_and_exists(Frame *frame) {
+  Node *f = frame->f;
+  Node *g = frame->g;
+  Node *cube = frame->h;
 
-  // Count the nodes
-  int *visited = (int *)calloc(unique_table.count + 1, sizeof(int));
-  if (!visited) {
-    fprintf(stderr, "Memory allocation failed for visited array\n");
-    free(bdd->var_order);
-    free(bdd);
-    exit(1);
+  // Terminal cases
+  if ((f->var == -1 && f->value == 0) || (g->var == -1 && g->value == 0)) {
+    return create_terminal(0);
+  }
+  if (f->var == -1 && g->var == -1) {
+    return create_terminal(1);
+  }
+  if (f->var == -1) {
+    forward_frame(frame, OP_EXISTS, g, cube, NULL);
+    return NULL;
+  }
+  if (g->var == -1 || f == g) {
+    forward_frame(frame, OP_EXISTS, f, cube, NULL);
+    return NULL;
   }
 
-  bdd->size = count_nodes(root, visited, 0);
-  free(visited);
+  int var = (f->var < g->var) ? f->var : g->var;
+  while (cube->var != -1 && cube->var < var) {
+    cube = cube_rest(cube);
+  }
+  if (cube->var == -1) {
+    forward_frame(frame, OP_AND, f, g, NULL);
+    return NULL;
+  }
 
-  return bdd;
+  if (f > g) {
+    frame->f = g;
+    frame->g = f;
+  }
+  frame->h = cube;
+
+  Node *cached = cache_lookup(OP_AND_EXISTS, frame->f, frame->g, cube);
+  if (cached)
+    return cached;
+
+  frame->cached = 1;
+  frame->var = var;
+  if (cube->var == var) {
+    frame->kind = FRAME_COMBINE;
+    frame->combine_op = OP_OR;
+    split_operands(frame, OP_AND_EXISTS, cube_rest(cube), cube_rest(cube));
+  } else {
+    frame->kind = FRAME_JOIN;
+    split_operands(frame, OP_AND_EXISTS, cube, cube);
+  }
+  return NULL;
 }
 
-// Generate a random variable ordering
-char *generate_random_order(int num_vars) {
-  char *order = (char *)malloc(num_vars + 1);
-  if (!order) {
-    fprintf(stderr, "Memory allocation failed for random ordering\n");
-    exit(1);
+// Expand a complement (OP_NOT)
+Node *expand_not(Frame *frame) {
+  Node *f = frame->f;
+  if (f->var == -1) {
+    return create_terminal(!f->value);
   }
 
-  // Initialize with sequential order
-  for (int i = 0; i < num_vars; i++) {
-    order[i] = 'A' + i;
+  Node *cached = cache_lookup(OP_NOT, f, NULL, NULL);
+  if (cached)
+    return cached;
+
+  frame->cached = 1;
+  frame->kind = FRAME_JOIN;
+  frame->var = f->var;
+  split_operands(frame, OP_NOT, NULL, NULL);
+  return NULL;
+}
+
+// Expand a ZDD set operation (OP_ZDD_UNION, OP_ZDD_INTERSECT, OP_ZDD_DIFF)
+Node *expand_zdd(Frame *frame) {
+  Node *f = frame->f;
+  Node *g = frame->g;
+  int f_empty = f->var == -1 && f->value == 0;
+  int g_empty = g->var == -1 && g->value == 0;
+
+  // Terminal cases - the 0-terminal is the empty family
+  switch (frame->op) {
+  case OP_ZDD_UNION:
+    if (f_empty || f == g)
+      return g;
+    if (g_empty)
+      return f;
+    break;
+  case OP_ZDD_INTERSECT:
+    if (f_empty || f == g)
+      return f;
+    if (g_empty)
+      return g;
+    break;
+  default:
+    if (f_empty || g_empty)
+      return f;
+    if (f == g)
+      return create_terminal(0);
+    break;
   }
-  order[num_vars] = '\0';
 
-  // Shuffle
-  for (int i = num_vars - 1; i > 0; i--) {
-    int j = rand() % (i + 1);
-    char temp = order[i];
-    order[i] = order[j];
-    order[j] = temp;
+  // Union and intersection are commutative
+  if (frame->op != OP_ZDD_DIFF && f > g) {
+    frame->f = g;
+    frame->g = f;
   }
 
-  return order;
+  Node *cached = cache_lookup(frame->op, frame->f, frame->g, NULL);
+  if (cached)
+    return cached;
+
+  // Terminals have no variable, the 1-terminal behaves as a node below all
+  // levels
+  frame->cached = 1;
+  frame->kind = FRAME_ZDD_JOIN;
+  if (f->var == -1 || g->var == -1) {
+    frame->var = (f->var == -1) ? g->var : f->var;
+  } else {
+    frame->var = (f->var < g->var) ? f->var : g->var;
+  }
+  split_zdd_operands(frame);
+  return NULL;
 }
 
-// Evaluate the BDD for given input values
-char BDD_use(BDD *bdd, const char *vstupy) {
-  if (!bdd || !bdd->root || !vstupy) {
-    return -1; // Error
+// Expand a frame according to its operation
+Node *expand_frame(Frame *frame) {
+  switch (frame->op) {
+  case OP_ZDD_UNION:
+  case OP_ZDD_INTERSECT:
+  case OP_ZDD_DIFF:
+    return expand_zdd(frame);
+  case OP_NOT:
+    return expand_not(frame);
+  case OP_OR:
+  case OP_AND:
+    return expand_apply(frame);
+  case OP_RESTRICT:
+    return expand_restrict(frame);
+  case OP_EXISTS:
+  case OP_FORALL:
+    return expand_quantify(frame);
+  default:
+    return expand_and_exists(frame);
   }
+}
 
-  Node *current = bdd->root;
+// Pop the top frame, recording its result. Returns -1 if the result cannot
+// be pushed
+int finish_frame(Node *result) {
+  Frame *frame = &work_stack.frames[work_stack.frame_count - 1];
+  if (frame->cached) {
+    cache_insert(frame->op, frame->f, frame->g, frame->h, result);
+  }
+  work_stack.frame_count--;
+  return push_value(result);
+}
 
-  // Traverse the BDD
-  while (current->var != -1) {
-    int var_idx = current->var;
+// Run an operation on the explicit work stack instead of the call stack, so
+// the depth of the diagrams is limited by memory only. Returns NULL if the
+// node budget or memory runs out
+Node *run_operation(int op, Node *f, Node *g, Node *h) {
+  int base = work_stack.frame_count;
+  int value_base = work_stack.value_count;
+  if (push_frame(op, f, g, h) != 0) {
+    return NULL;
+  }
 
-    if (var_idx >= strlen(bdd->var_order)) {
-      return -1; // Error: variable index out of bounds
+  while (work_stack.frame_count > base) {
+    // push_frame may move the frames - frame is not used after a push
+    Frame *frame = &work_stack.frames[work_stack.frame_count - 1];
+
+    switch (frame->state) {
+    case 0: {
+      Node *result = expand_frame(frame);
+      if (result) {
+        work_stack.frame_count--;
+        if (push_value(result) != 0) {
+          goto failed;
+        }
+        break;
+      }
+      frame->state = 1;
+      if (push_frame(frame->child_op, frame->child_f[0], frame->child_g[0],
+                     frame->child_h[0]) != 0) {
+        goto failed;
+      }
+      break;
     }
+    case 1: {
+      Node *low = work_stack.values[work_stack.value_count - 1];
+      if (low == NULL) {
+        goto failed;
+      }
+      if (frame->kind == FRAME_FORWARD) {
+        work_stack.value_count--;
+        if (finish_frame(low) != 0) {
+          goto failed;
+        }
+        break;
+      }
 
-    char var_name = bdd->var_order[var_idx];
-    int input_idx = var_name - 'A';
+      // The combination is already saturated - the high branch cannot
+      // change it
+      if (frame->kind == FRAME_COMBINE && low->var == -1 &&
+          low->value == (frame->combine_op == OP_OR)) {
+        work_stack.value_count--;
+        if (finish_frame(low) != 0) {
+          goto failed;
+        }
+        break;
+      }
 
-    if (input_idx < 0 || input_idx >= strlen(vstupy)) {
-      return -1; // Error: input index out of bounds
+      frame->state = 2;
+      if (push_frame(frame->child_op, frame->child_f[1], frame->child_g[1],
+                     frame->child_h[1]) != 0) {
+        goto failed;
+      }
+      break;
     }
+    case 2: {
+      Node *high = work_stack.values[--work_stack.value_count];
+      Node *low = work_stack.values[--work_stack.value_count];
+      if (high == NULL) {
+        goto failed;
+      }
+      if (frame->kind == FRAME_JOIN || frame->kind == FRAME_ZDD_JOIN) {
+        Node *result = frame->kind == FRAME_JOIN
+                           ? find_or_add_node(frame->var, low, high)
+                           : zdd_node(frame->var, low, high);
+        if (result == NULL) {
+          goto failed;
+        }
+        if (finish_frame(result) != 0) {
+          goto failed;
+        }
+        break;
+      }
 
-    char input_value = vstupy[input_idx];
-
-    // if (input_value == '0') {
-    //   current = current->low;
-    // } else if (input_value == '1') {
-    //   current = current->high;
-    // } else {
-    //   return -1; // Error: invalid input value
-    // }
-    input_value == '0' ? current = current->low : current->high;
-
-    if (!current) {
-      return -1; // Error: NULL node
+      frame->state = 3;
+      if (push_frame(frame->combine_op, low, high, NULL) != 0) {
+        goto failed;
+      }
+      break;
+    }
+    default: {
+      Node *result = work_stack.values[--work_stack.value_count];
+      if (result == NULL) {
+        goto failed;
+      }
+      if (finish_frame(result) != 0) {
+        goto failed;
+      }
+      break;
+    }
     }
   }
 
-  // Return the terminal value
-  return '0' + current->value;
+  return work_stack.values[--work_stack.value_count];
+
+failed:
+  // Drop the unfinished frames and their partial results
+  work_stack.frame_count = base;
+  work_stack.value_count = value_base;
+  return NULL;
 }
 
-// Generate a simple random Boolean function
-char *generate_random_boolean_function(int num_vars, int num_terms) {
-  if (num_terms <= 0)
-    num_terms = 1;
+// Task spawned by the parallel apply - one cofactor pair
+typedef struct Task {
+  int op;
+  Node *f;
+  Node *g;
+  int depth; // Recursion depth of the task's apply
+  Node *result;
+  int done; // Set once result is valid
+} Task;
+
+// Maximum number of tasks waiting in one worker's deque
+#define DEQUE_SIZE 4096
+
+// Maximum number of threads taking part in parallel apply
+#define MAX_WORKERS 64
+
+// Recursion levels that spawn tasks beyond log2 of the thread count. Deeper
+// subproblems are too small to pay for a task and run serially, while the
+// 2^SPAWN_SLACK_LEVELS tasks per thread leave room to balance the load
+#define SPAWN_SLACK_LEVELS 4
+
+// Worker of the parallel apply - owns a work-stealing deque of tasks
+// (Chase-Lev: the owner pushes and pops at bottom, thieves steal at top)
+typedef struct {
+  Task **tasks;
+  long top;
+  long bottom;
+  pthread_t thread;
+} Worker;
+
+// Worker pool
+Worker workers[MAX_WORKERS];
+int worker_count = 1;            // 1 = apply runs serially
+int spawn_depth = 0;             // Recursion levels that spawn tasks
+int pool_active = 0;             // Workers taking part in the current apply
+int pool_stopping = 0;           // Workers should exit
+__thread int worker_id = 0;      // The calling thread is worker 0
+pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t pool_wakeup = PTHREAD_COND_INITIALIZER;
+
+// Push a task onto the calling worker's deque. Returns 0 if it is full
+int deque_push(Worker *worker, Task *task) {
+  long bottom = __atomic_load_n(&worker->bottom, __ATOMIC_RELAXED);
+  long top = __atomic_load_n(&worker->top, __ATOMIC_ACQUIRE);
+  if (bottom - top >= DEQUE_SIZE) {
+    return 0;
+  }
 
-  // Allocate memory for the function (overestimate for safety)
-  char *function = (char *)malloc(num_vars * num_terms * 2 + num_terms);
-  if (!function) {
-    fprintf(stderr, "Memory allocation failed for random function\n");
-    exit(1);
+  __atomic_store_n(&worker->tasks[bottom % DEQUE_SIZE], task,
+                   __ATOMIC_RELAXED);
+  __atomic_store_n(&worker->bottom, bottom + 1, __ATOMIC_RELEASE);
+  return 1;
+}
+
+// Pop the newest task of the calling worker (NULL if it was stolen)
+Task *deque_pop(Worker *worker) {
+  long bottom = __atomic_load_n(&worker->bottom, __ATOMIC_RELAXED) - 1;
+  __atomic_store_n(&worker->bottom, bottom, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  long top = __atomic_load_n(&worker->top, __ATOMIC_RELAXED);
+
+  if (top > bottom) {
+    __atomic_store_n(&worker->bottom, bottom + 1, __ATOMIC_RELAXED);
+    return NULL;
   }
 
-  function[0] = '\0';
+  Task *task =
+      __atomic_load_n(&worker->tasks[bottom % DEQUE_SIZE], __ATOMIC_RELAXED);
+  if (top == bottom) {
+    // Last task - race the thieves for it
+    if (!__atomic_compare_exchange_n(&worker->top, &top, top + 1, 0,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+      task = NULL;
+    }
+    __atomic_store_n(&worker->bottom, bottom + 1, __ATOMIC_RELAXED);
+  }
+  return task;
+}
 
-  for (int i = 0; i < num_terms; i++) {
-    int term_length = 0;
-    char term[27] = {0}; // Max 26 variables (A-Z) + null terminator
+// Steal the oldest task of another worker (NULL if there is none)
+Task *deque_steal(Worker *worker) {
+  long top = __atomic_load_n(&worker->top, __ATOMIC_ACQUIRE);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  long bottom = __atomic_load_n(&worker->bottom, __ATOMIC_ACQUIRE);
+  if (top >= bottom) {
+    return NULL;
+  }
 
-    // Generate a random term
-    for (int j = 0; j < num_vars; j++) {
-      if (rand() % 3 > 0) {
-        // 2/3 chance to include variable
-        char var = 'A' + j;
-        term[term_length++] = var;
+  Task *task =
+      __atomic_load_n(&worker->tasks[top % DEQUE_SIZE], __ATOMIC_RELAXED);
+  if (!__atomic_compare_exchange_n(&worker->top, &top, top + 1, 0,
+                                   __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+    return NULL; // Lost the race to another thief or the owner
+  }
+  return task;
+}
+
+Node *parallel_apply(int op, Node *f, Node *g, int depth);
+
+// Run a task and publish its result
+void run_task(Task *task) {
+  task->result = parallel_apply(task->op, task->f, task->g, task->depth);
+  __atomic_store_n(&task->done, 1, __ATOMIC_RELEASE);
+}
+
+// Steal and run one task of another worker. Returns 0 if none was found
+int steal_work() {
+  for (int i = 1; i < worker_count; i++) {
+    Task *task = deque_steal(&workers[(worker_id + i) % worker_count]);
+    if (task) {
+      run_task(task);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Wait for a spawned task, running it directly if nobody stole it
+Node *sync_task(Task *task) {
+  if (deque_pop(&workers[worker_id]) == task) {
+    return parallel_apply(task->op, task->f, task->g, task->depth);
+  }
+
+  // Stolen - help the other workers until the thief is done
+  while (!__atomic_load_n(&task->done, __ATOMIC_ACQUIRE)) {
+    if (!steal_work()) {
+      sched_yield();
+    }
+  }
+  return task->result;
+}
+
+// Apply OR / AND with the two cofactor recursions running as tasks that
+// idle workers can steal. The recursion stops at spawn_depth, below which
+// the rest runs on the thread's explicit work stack
+Node *parallel_apply(int op, Node *f, Node *g, int depth) {
+  if (depth >= spawn_depth)
+    return run_operation(op, f, g, NULL);
+
+  Node *result = apply_shortcut(op, &f, &g);
+  if (result)
+    return result;
+
+  int var = (f->var < g->var) ? f->var : g->var;
+
+  // The high cofactors become a task, the low ones are done right away
+  Task task;
+  task.op = op;
+  task.f = (f->var == var) ? f->high : f;
+  task.g = (g->var == var) ? g->high : g;
+  task.depth = depth + 1;
+  task.done = 0;
+  int spawned = deque_push(&workers[worker_id], &task);
+
+  Node *low_result = parallel_apply(op, (f->var == var) ? f->low : f,
+                                    (g->var == var) ? g->low : g, depth + 1);
+  Node *high_result = spawned ? sync_task(&task)
+                              : parallel_apply(op, task.f, task.g, depth + 1);
+  if (low_result == NULL || high_result == NULL) {
+    return NULL; // Out of node budget or memory
+  }
+
+  result = find_or_add_node(var, low_result, high_result);
+  if (result != NULL) {
+    cache_insert(op, f, g, NULL, result);
+  }
+  return result;
+}
+
+// Main loop of a pool thread - steal work while an apply is in progress
+void *worker_main(void *arg) {
+  worker_id = (int)(intptr_t)arg;
+
+  for (;;) {
+    pthread_mutex_lock(&pool_mutex);
+    while (!pool_running && !pool_stopping) {
+      pthread_cond_wait(&pool_wakeup, &pool_mutex);
+    }
+    int stopping = pool_stopping;
+    if (!stopping) {
+      __atomic_fetch_add(&pool_active, 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&pool_mutex);
+
+    if (stopping)
+      break;
+
+    while (__atomic_load_n(&pool_running, __ATOMIC_ACQUIRE)) {
+      if (!steal_work()) {
+        sched_yield();
       }
     }
 
-    // Ensure each term has at least one variable
-    if (term_length == 0) {
-      term[term_length++] = 'A' + (rand() % num_vars);
+    flush_node_count();
+    __atomic_fetch_sub(&pool_active, 1, __ATOMIC_RELEASE);
+  }
+
+  free_work_stack();
+  return NULL;
+}
+
+// Run a parallel apply from the calling (main) thread with the whole pool
+Node *run_parallel_apply(int op, Node *f, Node *g) {
+  // Workers must only ever read the terminals
+  create_terminal(0);
+  create_terminal(1);
+
+  pthread_mutex_lock(&pool_mutex);
+  __atomic_store_n(&pool_running, 1, __ATOMIC_RELEASE);
+  pthread_cond_broadcast(&pool_wakeup);
+  pthread_mutex_unlock(&pool_mutex);
+
+  Node *result = parallel_apply(op, f, g, 0);
+  flush_node_count();
+
+  pthread_mutex_lock(&pool_mutex);
+  __atomic_store_n(&pool_running, 0, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&pool_mutex);
+
+  // Wait until every worker has published its nodes - the table can then
+  // grow again
+  while (__atomic_load_n(&pool_active, __ATOMIC_ACQUIRE) > 0) {
+    sched_yield();
+  }
+  grow_unique_table();
+
+  return result;
+}
+
+// Set the number of threads used by apply (1 = serial, the default)
+void BDD_set_threads(int threads) {
+  if (threads < 1)
+    threads = 1;
+  if (threads > MAX_WORKERS)
+    threads = MAX_WORKERS;
+
+  // Stop the current pool
+  if (worker_count > 1) {
+    pthread_mutex_lock(&pool_mutex);
+    pool_stopping = 1;
+    pthread_cond_broadcast(&pool_wakeup);
+    pthread_mutex_unlock(&pool_mutex);
+
+    for (int i = 1; i < worker_count; i++) {
+      pthread_join(workers[i].thread, NULL);
+    }
+    for (int i = 0; i < worker_count; i++) {
+      free(workers[i].tasks);
+      workers[i].tasks = NULL;
     }
+    pool_stopping = 0;
+  }
 
-    term[term_length] = '\0';
+  worker_count = threads;
+  if (threads == 1)
+    return;
 
-    // Add the term to the function
-    if (i > 0) {
-      strcat(function, "+");
+  spawn_depth = SPAWN_SLACK_LEVELS;
+  for (int n = 1; n < threads; n *= 2) {
+    spawn_depth++;
+  }
+
+  for (int i = 0; i < threads; i++) {
+    workers[i].tasks = (Task **)malloc(DEQUE_SIZE * sizeof(Task *));
+    if (!workers[i].tasks) {
+      // Fall back to serial apply
+      fprintf(stderr, "Memory allocation failed for task deque\n");
+      for (int j = 0; j < i; j++) {
+        free(workers[j].tasks);
+        workers[j].tasks = NULL;
+      }
+      worker_count = 1;
+      return;
     }
-    strcat(function, term);
+    workers[i].top = 0;
+    workers[i].bottom = 0;
   }
 
-  return function;
+  for (int i = 1; i < threads; i++) {
+    if (pthread_create(&workers[i].thread, NULL, worker_main,
+                       (void *)(intptr_t)i) != 0) {
+      // Go on with the workers that did start (serially if none did)
+      fprintf(stderr, "Failed to start worker thread\n");
+      worker_count = i;
+      for (int j = worker_count > 1 ? i : 0; j < threads; j++) {
+        free(workers[j].tasks);
+        workers[j].tasks = NULL;
+      }
+      return;
+    }
+  }
 }
 
-void free_unique_table() {
-  // Safety check
-  if (unique_table.buckets == NULL)
+// Apply operation (OR) between two BDDs
+Node *apply_or(Node *f, Node *g) {
+  if (worker_count > 1)
+    return run_parallel_apply(OP_OR, f, g);
+  return run_operation(OP_OR, f, g, NULL);
+}
+
+// Apply operation (AND) between two BDDs
+Node *apply_and(Node *f, Node *g) {
+  if (worker_count > 1)
+    return run_parallel_apply(OP_AND, f, g);
+  return run_operation(OP_AND, f, g, NULL);
+}
+
+// Create an empty term tree (the OR of no terms is 0). Returns NULL if it
+// cannot be allocated
+TermTree *create_term_tree() {
+  TermTree *tree = (TermTree *)malloc(sizeof(TermTree));
+  if (!tree) {
+    fprintf(stderr, "Memory allocation failed for term tree\n");
+    return NULL;
+  }
+
+  tree->capacity = 1;
+  tree->count = 0;
+  tree->nodes = (Node **)malloc(2 * sizeof(Node *));
+  if (!tree->nodes) {
+    fprintf(stderr, "Memory allocation failed for term tree nodes\n");
+    free(tree);
+    return NULL;
+  }
+  tree->nodes[0] = NULL; // Unused
+  tree->nodes[1] = create_terminal(0);
+
+  return tree;
+}
+
+// Copy a term tree (the nodes themselves stay shared). Returns NULL if the
+// copy cannot be allocated
+TermTree *clone_term_tree(TermTree *source) {
+  TermTree *tree = (TermTree *)malloc(sizeof(TermTree));
+  if (!tree) {
+    fprintf(stderr, "Memory allocation failed for term tree\n");
+    return NULL;
+  }
+
+  tree->capacity = source->capacity;
+  tree->count = source->count;
+  tree->nodes = (Node **)malloc(2 * source->capacity * sizeof(Node *));
+  if (!tree->nodes) {
+    fprintf(stderr, "Memory allocation failed for term tree nodes\n");
+    free(tree);
+    return NULL;
+  }
+  memcpy(tree->nodes, source->nodes, 2 * source->capacity * sizeof(Node *));
+
+  return tree;
+}
+
+void free_term_tree(TermTree *tree) {
+  if (!tree)
     return;
 
-  // Free all nodes in the unique table except terminal nodes
-  for (int i = 0; i < unique_table.size; i++) {
-    Node *p = unique_table.buckets[i];
-    while (p != NULL) {
-      Node *next = p->next;
-      // Don't free terminal nodes here - they're handled separately
-      if (p != zero_terminal && p != one_terminal) {
-        free(p);
+  free(tree->nodes);
+  free(tree);
+}
+
+// Recompute the ORs on the path from a leaf to the root. Returns -1 if the
+// node budget or memory runs out - recomputing after the leaf is restored
+// then only finds existing nodes, so it does not hit the budget again
+int term_tree_update(TermTree *tree, int index) {
+  for (int i = index / 2; i >= 1; i /= 2) {
+    Node *result = apply_or(tree->nodes[2 * i], tree->nodes[2 * i + 1]);
+    if (result == NULL) {
+      return -1;
+    }
+    tree->nodes[i] = result;
+  }
+  return 0;
+}
+
+// Fill an empty tree with count term BDDs at once - the leaves are sized to
+// the next power of two and every inner node is computed once, bottom up.
+// Returns -1 (leaving the tree empty) if the node budget or memory runs out
+int term_tree_build(TermTree *tree, Node **terms, int count) {
+  int capacity = 1;
+  while (capacity < count) {
+    capacity *= 2;
+  }
+
+  Node **nodes = (Node **)malloc(2 * capacity * sizeof(Node *));
+  if (!nodes) {
+    fprintf(stderr, "Memory allocation failed for term tree nodes\n");
+    return -1;
+  }
+
+  nodes[0] = NULL;
+  for (int i = 0; i < capacity; i++) {
+    nodes[capacity + i] = i < count ? terms[i] : create_terminal(0);
+  }
+  for (int i = capacity - 1; i >= 1; i--) {
+    nodes[i] = apply_or(nodes[2 * i], nodes[2 * i + 1]);
+    if (nodes[i] == NULL) {
+      free(nodes);
+      return -1;
+    }
+  }
+
+  free(tree->nodes);
+  tree->nodes = nodes;
+  tree->capacity = capacity;
+  tree->count = count;
+
+  return 0;
+}
+
+// Add a term BDD to the tree. Returns -1 (leaving the tree unchanged) if the
+// node budget or memory runs out
+int term_tree_insert(TermTree *tree, Node *term) {
+  if (tree->count == tree->capacity) {
+    // Double the number of leaves. The old tree becomes the left subtree of
+    // the new root - node i on the level starting at index first moves to
+    // i + first - and the right subtree holds only 0-terminals, so since
+    // OR(x, 0) = x no inner node has to be recomputed
+    int capacity = tree->capacity * 2;
+    Node **nodes = (Node **)malloc(2 * capacity * sizeof(Node *));
+    if (!nodes) {
+      fprintf(stderr, "Memory allocation failed for term tree nodes\n");
+      return -1;
+    }
+
+    nodes[0] = NULL;
+    nodes[1] = tree->nodes[1];
+    for (int first = 1; first < capacity; first *= 2) {
+      for (int i = first; i < 2 * first; i++) {
+        nodes[i + first] = tree->nodes[i];
+        nodes[i + 2 * first] = create_terminal(0);
       }
-      p = next;
     }
+
+    free(tree->nodes);
+    tree->nodes = nodes;
+    tree->capacity = capacity;
   }
 
-  free(unique_table.buckets);
-  unique_table.buckets = NULL;
-  unique_table.size = 0;
-  unique_table.count = 0;
+  int leaf = tree->capacity + tree->count;
+  tree->nodes[leaf] = term;
+  if (term_tree_update(tree, leaf) != 0) {
+    tree->nodes[leaf] = create_terminal(0);
+    term_tree_update(tree, leaf);
+    return -1;
+  }
+  tree->count++;
+
+  return 0;
 }
 
-// Clone a BDD structure including all of its nodes
-BDD *BDD_clone(BDD *source) {
-  if (!source)
+// Remove one occurrence of a term BDD. Returns -1 if the tree has none or
+// the node budget runs out (the tree is then left unchanged)
+int term_tree_remove(TermTree *tree, Node *term) {
+  int leaf = tree->capacity;
+  while (leaf < tree->capacity + tree->count && tree->nodes[leaf] != term) {
+    leaf++;
+  }
+  if (leaf == tree->capacity + tree->count) {
+    return -1;
+  }
+
+  // Move the last term into the gap so the used leaves stay contiguous
+  int last = tree->capacity + tree->count - 1;
+  tree->nodes[leaf] = tree->nodes[last];
+  tree->nodes[last] = create_terminal(0);
+
+  if (term_tree_update(tree, leaf) != 0 || term_tree_update(tree, last) != 0) {
+    tree->nodes[last] = tree->nodes[leaf];
+    tree->nodes[leaf] = term;
+    term_tree_update(tree, leaf);
+    term_tree_update(tree, last);
+    return -1;
+  }
+  tree->count--;
+
+  return 0;
+}
+
+// Find the product term of a Boolean function starting at *position. Returns
+// the index where the term starts (-1 at the end of the function), with its
+// length in *length and *position moved past the term and its '+' separator
+int next_term(const char *bfunkcia, int *position, int *length) {
+  int start = *position;
+  if (bfunkcia[start] == '\0') {
+    return -1;
+  }
+
+  int end = start;
+  while (bfunkcia[end] != '\0' && bfunkcia[end] != '+') {
+    end++;
+  }
+  *length = end - start;
+
+  // Skip the '+' separator
+  *position = bfunkcia[end] == '+' ? end + 1 : end;
+  return start;
+}
+
+// Check a Boolean function and its variable ordering, and make sure the
+// terminals and the unique table exist. Returns the number of variables, -1
+// for invalid input or if memory runs out
+int prepare_function(const char *bfunkcia, const char *poradie) {
+  if (!bfunkcia || !poradie) {
+    fprintf(stderr, "Invalid input parameters\n");
+    return -1;
+  }
+
+  int num_vars = count_variables(bfunkcia);
+  if ((int)strlen(poradie) < num_vars) {
+    fprintf(stderr, "Variable ordering has insufficient variables\n");
+    return -1;
+  }
+
+  // Initialize terminal nodes
+  zero_terminal = create_terminal(0);
+  one_terminal = create_terminal(1);
+  if (!zero_terminal || !one_terminal) {
+    return -1;
+  }
+
+  // Initialize the unique table unless other BDDs already live in it
+  if (unique_table.buckets == NULL) {
+    init_unique_table(10000);
+    if (unique_table.buckets == NULL) {
+      return -1;
+    }
+  }
+
+  return num_vars;
+}
+
+// Build a BDD from a Boolean function and variable ordering, recording each
+// product term in the tree. Returns NULL if a term cannot be built or the
+// node budget or memory runs out
+Node *build_bdd(const char *bfunkcia, const char *var_order, int num_vars,
+                TermTree *terms) {
+  int count = 0;
+  int capacity = 16;
+  Node **term_nodes = (Node **)malloc(capacity * sizeof(Node *));
+  if (!term_nodes) {
+    fprintf(stderr, "Memory allocation failed for term nodes\n");
     return NULL;
+  }
 
-  // Create a new BDD structure
-  BDD *new_bdd = (BDD *)malloc(sizeof(BDD));
-  if (!new_bdd) {
-    fprintf(stderr, "Memory allocation failed for BDD clone\n");
+  // Build every term first, then the whole tree in one pass
+  int position = 0;
+  int start;
+  int length;
+  while ((start = next_term(bfunkcia, &position, &length)) >= 0) {
+    Node *term = create_term_bdd(bfunkcia + start, length, var_order,
+                                 num_vars);
+    if (!term) {
+      free(term_nodes);
+      return NULL;
+    }
+    if (count == capacity) {
+      capacity *= 2;
+      Node **grown =
+          (Node **)realloc(term_nodes, capacity * sizeof(Node *));
+      if (!grown) {
+        fprintf(stderr, "Memory allocation failed for term nodes\n");
+        free(term_nodes);
+        return NULL;
+      }
+      term_nodes = grown;
+    }
+    term_nodes[count++] = term;
+  }
+
+  int status = term_tree_build(terms, term_nodes, count);
+  free(term_nodes);
+  if (status != 0) {
     return NULL;
   }
 
-  // Copy simple fields
-  new_bdd->num_vars = source->num_vars;
-  new_bdd->size = source->size;
+  return terms->nodes[1];
+}
 
-  // Copy variable ordering
-  new_bdd->var_order = (char *)malloc(strlen(source->var_order) + 1);
-  if (!new_bdd->var_order) {
-    fprintf(stderr,
-            "Memory allocation failed for variable ordering in clone\n");
-    free(new_bdd);
+// Entry of a NodeMap - a node (with an integer tag) and an associated node
+typedef struct {
+  Node *key; // NULL for an empty slot
+  int tag;
+  Node *value;
+} NodeMapEntry;
+
+// Open-addressing map from (node, tag) to node, used as scratch memo and
+// visited set by the traversals
+typedef struct {
+  NodeMapEntry *entries;
+  int capacity; // Power of two
+  int count;
+} NodeMap;
+
+// Create an empty map (NULL if it cannot be allocated)
+NodeMap *create_node_map() {
+  NodeMap *map = (NodeMap *)malloc(sizeof(NodeMap));
+  if (!map) {
+    fprintf(stderr, "Memory allocation failed for node map\n");
     return NULL;
   }
-  strcpy(new_bdd->var_order, source->var_order);
 
-  // The root pointer remains the same - we don't clone the nodes
-  // since they're in the unique table and should be shared
-  new_bdd->root = source->root;
+  map->capacity = 64;
+  map->count = 0;
+  map->entries = (NodeMapEntry *)calloc(map->capacity, sizeof(NodeMapEntry));
+  if (!map->entries) {
+    fprintf(stderr, "Memory allocation failed for node map entries\n");
+    free(map);
+    return NULL;
+  }
 
-  return new_bdd;
+  return map;
+}
+
+void free_node_map(NodeMap *map) {
+  if (!map)
+    return;
+
+  free(map->entries);
+  free(map);
+}
+
+// Slot holding (key, tag), or the empty slot where it belongs
+NodeMapEntry *node_map_slot(NodeMap *map, Node *key, int tag) {
+  unsigned long hash = ((unsigned long)key >> 4) * 1009 + (unsigned long)tag;
+  int slot = (int)(hash & (map->capacity - 1));
+
+  while (map->entries[slot].key != NULL &&
+         (map->entries[slot].key != key || map->entries[slot].tag != tag)) {
+    slot = (slot + 1) & (map->capacity - 1);
+  }
+  return &map->entries[slot];
+}
+
+// Look up (key, tag) - NULL if the map does not contain it
+NodeMapEntry *node_map_find(NodeMap *map, Node *key, int tag) {
+  NodeMapEntry *entry = node_map_slot(map, key, tag);
+  return entry->key != NULL ? entry : NULL;
+}
+
+// Add or overwrite (key, tag). Returns -1 (leaving the map unchanged) if it
+// cannot grow
+int node_map_put(NodeMap *map, Node *key, int tag, Node *value) {
+  if (2 * (map->count + 1) > map->capacity) {
+    // Rehash into twice the capacity
+    NodeMapEntry *entries =
+        (NodeMapEntry *)calloc(2 * map->capacity, sizeof(NodeMapEntry));
+    if (!entries) {
+      fprintf(stderr, "Memory allocation failed for node map entries\n");
+      return -1;
+    }
+
+    NodeMapEntry *old = map->entries;
+    int old_capacity = map->capacity;
+    map->capacity *= 2;
+    map->entries = entries;
+    for (int i = 0; i < old_capacity; i++) {
+      if (old[i].key != NULL) {
+        *node_map_slot(map, old[i].key, old[i].tag) = old[i];
+      }
+    }
+    free(old);
+  }
+
+  NodeMapEntry *entry = node_map_slot(map, key, tag);
+  if (entry->key == NULL) {
+    map->count++;
+  }
+  entry->key = key;
+  entry->tag = tag;
+  entry->value = value;
+  return 0;
+}
+
+// Number of internal nodes reachable from a node (-1 if memory runs out)
+int subgraph_size(Node *root) {
+  if (root->var == -1)
+    return 0;
+
+  int size = -1;
+  int capacity = 256;
+  int top = 0;
+  NodeMap *visited = create_node_map();
+  Node **stack = (Node **)malloc(capacity * sizeof(Node *));
+  if (!visited || !stack) {
+    if (!stack)
+      fprintf(stderr, "Memory allocation failed for node stack\n");
+    goto done;
+  }
+  stack[top++] = root;
+  if (node_map_put(visited, root, 0, NULL) != 0)
+    goto done;
+
+  while (top > 0) {
+    Node *node = stack[--top];
+    Node *child[2] = {node->low, node->high};
+
+    for (int i = 0; i < 2; i++) {
+      if (child[i]->var == -1 || node_map_find(visited, child[i], 0))
+        continue;
+
+      if (node_map_put(visited, child[i], 0, NULL) != 0)
+        goto done;
+      if (top == capacity) {
+        Node **grown =
+            (Node **)realloc(stack, 2 * capacity * sizeof(Node *));
+        if (!grown) {
+          fprintf(stderr, "Memory allocation failed for node stack\n");
+          goto done;
+        }
+        stack = grown;
+        capacity *= 2;
+      }
+      stack[top++] = child[i];
+    }
+  }
+  size = visited->count;
+
+done:
+  free(stack);
+  free_node_map(visited);
+  return size;
 }
 
-void BDD_reset_system() {
-  // Free the unique table, which includes all nodes
-  free_unique_table();
+// Memoized bottom-up rewrites of a diagram, each a function of a node and an
+// integer tag
+enum {
+  TRANSFORM_SHORT_PATH, // Keep the paths to 1 testing at most tag variables
+  TRANSFORM_BDD_TO_ZDD, // Satisfying assignments of a BDD on levels tag and
+                        // below as a ZDD of the sets of variables set to 1
+  TRANSFORM_ZDD_TO_BDD, // The inverse - a BDD satisfied by the sets of a ZDD
+  TRANSFORM_ZDD_COVER   // A ZDD read as a sum of products, as a BDD
+};
+
+// Pending rewrite on the explicit stack of run_transform
+typedef struct {
+  Node *node;
+  int tag;
+} TransformItem;
+
+// Result of a rewrite that needs no child rewrites (NULL if it needs them)
+Node *transform_base(int kind, Node *node, int tag, int num_vars) {
+  switch (kind) {
+  case TRANSFORM_SHORT_PATH:
+    if (node->var == -1)
+      return node;
+    return tag == 0 ? create_terminal(0) : NULL;
+  case TRANSFORM_BDD_TO_ZDD:
+  case TRANSFORM_ZDD_TO_BDD:
+    return tag == num_vars ? node : NULL;
+  default:
+    return node->var == -1 ? node : NULL;
+  }
+}
+
+// Operands of the two child rewrites - [0] low, [1] high
+void transform_children(int kind, Node *node, int tag, int num_vars,
+                        TransformItem child[2]) {
+  switch (kind) {
+  case TRANSFORM_SHORT_PATH:
+    child[0].node = node->low;
+    child[1].node = node->high;
+    child[0].tag = child[1].tag = tag - 1;
+    break;
+  case TRANSFORM_BDD_TO_ZDD:
+  case TRANSFORM_ZDD_TO_BDD:
+    child[0].tag = child[1].tag = tag + 1;
+    if (node->var == tag) {
+      child[0].node = node->low;
+      child[1].node = node->high;
+    } else if (kind == TRANSFORM_BDD_TO_ZDD) {
+      // The BDD skips the level - both values of the variable satisfy it
+      child[0].node = child[1].node = node;
+    } else {
+      // The ZDD suppressed the level - no set contains the variable
+      child[0].node = node;
+      child[1].node = create_terminal(0);
+      child[1].tag = num_vars;
+    }
+    break;
+  default:
+    child[0].node = node->low;
+    child[1].node = node->high;
+    child[0].tag = child[1].tag = 0;
+    break;
+  }
+}
+
+// Rewrite of a node from the rewrites of its children (NULL if the node
+// budget runs out)
+Node *transform_combine(int kind, Node *node, int tag, Node *low, Node *high) {
+  switch (kind) {
+  case TRANSFORM_SHORT_PATH:
+    return find_or_add_node(node->var, low, high);
+  case TRANSFORM_BDD_TO_ZDD:
+    return zdd_node(tag, low, high);
+  case TRANSFORM_ZDD_TO_BDD:
+    return find_or_add_node(tag, low, high);
+  default: {
+    // Terms without the variable hold for both of its values, terms with it
+    // only when it is 1
+    Node *either = run_operation(OP_OR, low, high, NULL);
+    return either ? find_or_add_node(node->var, low, either) : NULL;
+  }
+  }
+}
+
+// Run a rewrite on an explicit stack instead of the call stack, remembering
+// every result in memo. Returns NULL if the node budget or memory runs out
+// (including a memo the caller could not allocate)
+Node *run_transform(int kind, Node *root, int tag, int num_vars,
+                    NodeMap *memo) {
+  Node *result = transform_base(kind, root, tag, num_vars);
+  if (result || !memo)
+    return result;
+
+  int capacity = 256;
+  int top = 0;
+  TransformItem *stack =
+      (TransformItem *)malloc(capacity * sizeof(TransformItem));
+  if (!stack) {
+    fprintf(stderr, "Memory allocation failed for transform stack\n");
+    return NULL;
+  }
+  stack[top].node = root;
+  stack[top++].tag = tag;
+
+  while (top > 0) {
+    TransformItem item = stack[top - 1];
+    if (node_map_find(memo, item.node, item.tag)) {
+      top--; // Pushed twice and already done
+      continue;
+    }
+
+    // Collect the children's results, scheduling those still missing
+    TransformItem child[2];
+    Node *child_result[2];
+    int pending = 0;
+    transform_children(kind, item.node, item.tag, num_vars, child);
+    for (int i = 0; i < 2; i++) {
+      child_result[i] =
+          transform_base(kind, child[i].node, child[i].tag, num_vars);
+      if (child_result[i] == NULL) {
+        NodeMapEntry *entry = node_map_find(memo, child[i].node, child[i].tag);
+        child_result[i] = entry ? entry->value : NULL;
+      }
+      if (child_result[i] != NULL)
+        continue;
+
+      if (top == capacity) {
+        capacity *= 2;
+        TransformItem *grown = (TransformItem *)realloc(
+            stack, capacity * sizeof(TransformItem));
+        if (!grown) {
+          fprintf(stderr, "Memory allocation failed for transform stack\n");
+          free(stack);
+          return NULL;
+        }
+        stack = grown;
+      }
+      stack[top++] = child[i];
+      pending = 1;
+    }
+    if (pending)
+      continue;
+
+    result = transform_combine(kind, item.node, item.tag, child_result[0],
+                               child_result[1]);
+    if (result == NULL ||
+        node_map_put(memo, item.node, item.tag, result) != 0) {
+      free(stack);
+      return NULL;
+    }
+    top--;
+  }
+
+  free(stack);
+  return node_map_find(memo, root, tag)->value;
+}
+
+// Create a BDD for a Boolean function with a given variable ordering
+BDD *BDD_create(const char *bfunkcia, const char *poradie) {
+  int num_vars = prepare_function(bfunkcia, poradie);
+  if (num_vars < 0) {
+    return NULL;
+  }
+
+  // Build the BDD
+  TermTree *terms = create_term_tree();
+  Node *root = terms ? build_bdd(bfunkcia, poradie, num_vars, terms) : NULL;
+  if (!root) {
+    free_term_tree(terms);
+    return NULL;
+  }
+
+  // Create the BDD structure
+  BDD *bdd = (BDD *)malloc(sizeof(BDD));
+  if (!bdd) {
+    fprintf(stderr, "Memory allocation failed for BDD\n");
+    free_term_tree(terms);
+    return NULL;
+  }
+
+  bdd->num_vars = num_vars;
+  bdd->root = root;
+  bdd->terms = terms;
+
+  // Copy the variable ordering
+  bdd->var_order = (char *)malloc(strlen(poradie) + 1);
+  if (!bdd->var_order) {
+    fprintf(stderr, "Memory allocation failed for variable ordering\n");
+    free_term_tree(terms);
+    free(bdd);
+    return NULL;
+  }
+
+  strcpy(bdd->var_order, poradie);
+
+  // Count the nodes
+  bdd->size = subgraph_size(root);
+  if (bdd->size < 0) {
+    free(bdd->var_order);
+    free_term_tree(terms);
+    free(bdd);
+    return NULL;
+  }
+
+  return bdd;
+}
+
+// Free the BDD
+void BDD_free(BDD *bdd) {
+  if (!bdd)
+    return;
+
+  if (bdd->var_order) {
+    free(bdd->var_order);
+  }
+
+  free_term_tree(bdd->terms);
+  free(bdd);
+}
+
+// Recount the nodes of a BDD after its root changed. Returns -1 (keeping the
+// old size) if memory runs out
+int update_bdd_size(BDD *bdd) {
+  int size = subgraph_size(bdd->root);
+  if (size < 0)
+    return -1;
+
+  bdd->size = size;
+  return 0;
+}
+
+// Build the BDD of a single product term for an editable BDD, extending the
+// BDD's variables if the term uses new ones
+Node *create_edit_term(BDD *bdd, const char *term) {
+  if (!bdd || !bdd->terms || !term) {
+    fprintf(stderr, "Invalid input parameters\n");
+    return NULL;
+  }
+
+  int num_vars = count_variables(term);
+  if (num_vars < bdd->num_vars) {
+    num_vars = bdd->num_vars;
+  }
+  if ((int)strlen(bdd->var_order) < num_vars) {
+    fprintf(stderr, "Variable ordering has insufficient variables\n");
+    return NULL;
+  }
+
+  Node *node = create_term_bdd(term, strlen(term), bdd->var_order, num_vars);
+  if (node) {
+    bdd->num_vars = num_vars;
+  }
+  return node;
+}
+
+// OR a product term into the BDD. Only the path from the term's leaf to the
+// root of the term tree is recomputed. Returns 0 on success, -1 on error
+// (including running out of the node budget)
+int BDD_add_term(BDD *bdd, const char *term) {
+  Node *node = create_edit_term(bdd, term);
+  if (!node) {
+    return -1;
+  }
+
+  if (term_tree_insert(bdd->terms, node) != 0) {
+    return -1;
+  }
+
+  Node *old_root = bdd->root;
+  bdd->root = bdd->terms->nodes[1];
+  if (update_bdd_size(bdd) != 0) {
+    // Undo the insert - this only finds existing nodes
+    term_tree_remove(bdd->terms, node);
+    bdd->root = old_root;
+    return -1;
+  }
+
+  return 0;
+}
+
+// Remove one occurrence of a product term from the BDD. Returns 0 on success,
+// -1 on error or if the BDD does not contain the term
+int BDD_remove_term(BDD *bdd, const char *term) {
+  Node *node = create_edit_term(bdd, term);
+  if (!node || term_tree_remove(bdd->terms, node) != 0) {
+    return -1;
+  }
+
+  Node *old_root = bdd->root;
+  bdd->root = bdd->terms->nodes[1];
+  if (update_bdd_size(bdd) != 0) {
+    // Undo the removal - this only finds existing nodes
+    term_tree_insert(bdd->terms, node);
+    bdd->root = old_root;
+    return -1;
+  }
+
+  return 0;
+}
+
+// Generate a random variable ordering (NULL if it cannot be allocated)
+char *generate_random_order(int num_vars) {
+  char *order = (char *)malloc(num_vars + 1);
+  if (!order) {
+    fprintf(stderr, "Memory allocation failed for random ordering\n");
+    return NULL;
+  }
+
+  // Initialize with sequential order
+  for (int i = 0; i < num_vars; i++) {
+    order[i] = 'A' + i;
+  }
+  order[num_vars] = '\0';
+
+  // Shuffle
+  for (int i = num_vars - 1; i > 0; i--) {
+    int j = rand() % (i + 1);
+    char temp = order[i];
+    order[i] = order[j];
+    order[j] = temp;
+  }
+
+  return order;
+}
+
+// Evaluate the BDD for given input values
+char BDD_use(BDD *bdd, const char *vstupy) {
+  if (!bdd || !bdd->root || !vstupy) {
+    return -1; // Error
+  }
+
+  Node *current = bdd->root;
+
+  // Traverse the BDD
+  while (current->var != -1) {
+    int var_idx = current->var;
+
+    if (var_idx >= strlen(bdd->var_order)) {
+      return -1; // Error: variable index out of bounds
+    }
+
+    char var_name = bdd->var_order[var_idx];
+    int input_idx = var_name - 'A';
+
+    if (input_idx < 0 || input_idx >= strlen(vstupy)) {
+      return -1; // Error: input index out of bounds
+    }
+
+    char input_value = vstupy[input_idx];
+
+    if (input_value == '0') {
+      current = current->low;
+    } else if (input_value == '1') {
+      current = current->high;
+    } else {
+      return -1; // Error: invalid input value
+    }
+
+    if (!current) {
+      return -1; // Error: NULL node
+    }
+  }
+
+  // Return the terminal value
+  return '0' + current->value;
+}
+
+// Generate a simple random Boolean function
+char *generate_random_boolean_function(int num_vars, int num_terms) {
+  if (num_terms <= 0)
+    num_terms = 1;
+
+  // Allocate memory for the function (overestimate for safety)
+  char *function = (char *)malloc(num_vars * num_terms * 2 + num_terms);
+  if (!function) {
+    fprintf(stderr, "Memory allocation failed for random function\n");
+    exit(1);
+  }
+
+  function[0] = '\0';
+
+  for (int i = 0; i < num_terms; i++) {
+    int term_length = 0;
+    char term[27] = {0}; // Max 26 variables (A-Z) + null terminator
+
+    // Generate a random term
+    for (int j = 0; j < num_vars; j++) {
+      if (rand() % 3 > 0) {
+        // 2/3 chance to include variable
+        char var = 'A' + j;
+        term[term_length++] = var;
+      }
+    }
+
+    // Ensure each term has at least one variable
+    if (term_length == 0) {
+      term[term_length++] = 'A' + (rand() % num_vars);
+    }
+
+    term[term_length] = '\0';
+
+    // Add the term to the function
+    if (i > 0) {
+      strcat(function, "+");
+    }
+    strcat(function, term);
+  }
+
+  return function;
+}
+
+void free_unique_table() {
+  // Safety check
+  if (unique_table.buckets == NULL)
+    return;
+
+  // Free all nodes in the unique table except terminal nodes
+  for (int i = 0; i < unique_table.size; i++) {
+    Node *p = unique_table.buckets[i];
+    while (p != NULL) {
+      Node *next = p->next;
+      // Don't free terminal nodes here - they're handled separately
+      if (p != zero_terminal && p != one_terminal) {
+        free(p);
+      }
+      p = next;
+    }
+  }
+
+  free(unique_table.buckets);
+  unique_table.buckets = NULL;
+  unique_table.size = 0;
+  unique_table.count = 0;
+
+  free(computed_table.entries);
+  computed_table.entries = NULL;
+  computed_table.size = 0;
+
+  free_work_stack();
+}
+
+// Clone a BDD structure including all of its nodes
+BDD *BDD_clone(BDD *source) {
+  if (!source)
+    return NULL;
+
+  // Create a new BDD structure
+  BDD *new_bdd = (BDD *)malloc(sizeof(BDD));
+  if (!new_bdd) {
+    fprintf(stderr, "Memory allocation failed for BDD clone\n");
+    return NULL;
+  }
+
+  // Copy simple fields
+  new_bdd->num_vars = source->num_vars;
+  new_bdd->size = source->size;
+
+  // Copy variable ordering
+  new_bdd->var_order = (char *)malloc(strlen(source->var_order) + 1);
+  if (!new_bdd->var_order) {
+    fprintf(stderr,
+            "Memory allocation failed for variable ordering in clone\n");
+    free(new_bdd);
+    return NULL;
+  }
+  strcpy(new_bdd->var_order, source->var_order);
+
+  // The root pointer remains the same - we don't clone the nodes
+  // since they're in the unique table and should be shared
+  new_bdd->root = source->root;
+  new_bdd->terms = NULL;
+  if (source->terms) {
+    new_bdd->terms = clone_term_tree(source->terms);
+    if (!new_bdd->terms) {
+      BDD_free(new_bdd);
+      return NULL;
+    }
+  }
+
+  return new_bdd;
+}
+
+void BDD_reset_system() {
+  // Free the unique table, which includes all nodes
+  free_unique_table();
+
+  // Reset terminal nodes
+  if (zero_terminal != NULL) {
+    free(zero_terminal);
+    zero_terminal = NULL;
+  }
+
+  if (one_terminal != NULL) {
+    free(one_terminal);
+    one_terminal = NULL;
+  }
+}
+
+// Compare two term masks for qsort
+int compare_term_masks(const void *a, const void *b) {
+  unsigned long x = *(const unsigned long *)a;
+  unsigned long y = *(const unsigned long *)b;
+  return (x > y) - (x < y);
+}
+
+// Fingerprint of a Boolean function - a hash of its set of product terms,
+// so reordered terms, reordered literals and repeated terms all map to the
+// same value (0 if memory runs out)
+unsigned long long BDD_fingerprint(const char *bfunkcia) {
+  int capacity = 16;
+  int count = 0;
+  unsigned long *masks = (unsigned long *)malloc(capacity * sizeof(long));
+  if (!masks) {
+    fprintf(stderr, "Memory allocation failed for term masks\n");
+    return 0;
+  }
+
+  // One bit per variable of each product term
+  int position = 0;
+  int start;
+  int length;
+  while ((start = next_term(bfunkcia, &position, &length)) >= 0) {
+    unsigned long mask = 0;
+    for (int i = start; i < start + length; i++) {
+      if (bfunkcia[i] >= 'A' && bfunkcia[i] <= 'Z') {
+        mask |= 1UL << (bfunkcia[i] - 'A');
+      } else if (bfunkcia[i] >= 'a' && bfunkcia[i] <= 'z') {
+        mask |= 1UL << (bfunkcia[i] - 'a');
+      }
+    }
+
+    if (count == capacity) {
+      capacity *= 2;
+      unsigned long *grown =
+          (unsigned long *)realloc(masks, capacity * sizeof(long));
+      if (!grown) {
+        fprintf(stderr, "Memory allocation failed for term masks\n");
+        free(masks);
+        return 0;
+      }
+      masks = grown;
+    }
+    masks[count++] = mask;
+  }
+
+  qsort(masks, count, sizeof(long), compare_term_masks);
+
+  // FNV-1a over the distinct masks
+  unsigned long long hash = 14695981039346656037ULL;
+  for (int j = 0; j < count; j++) {
+    if (j > 0 && masks[j] == masks[j - 1])
+      continue;
+    for (int byte = 0; byte < 4; byte++) {
+      hash ^= (masks[j] >> (8 * byte)) & 0xff;
+      hash *= 1099511628211ULL;
+    }
+  }
+
+  free(masks);
+  return hash;
+}
+
+// Entry of the ordering cache file - one line per function:
+// <fingerprint> <best order> <size> <orders tried so far>
+typedef struct {
+  unsigned long long fingerprint;
+  char order[27];
+  int size;
+  long tries;
+} OrderCacheEntry;
+
+// Ordering cache file used by BDD_create_with_best_order (NULL = disabled)
+char *order_cache_path = NULL;
+
+// Orders tried on top of a cached one, so the stored result keeps improving
+int order_cache_extra_tries = 0;
+
+// Enable the persistent ordering cache in a local file (NULL disables it).
+// On a hit BDD_create_with_best_order starts from the stored order and only
+// tries extra_tries neighbouring orders instead of a full search
+void BDD_set_order_cache(const char *path, int extra_tries) {
+  free(order_cache_path);
+  order_cache_path = path ? strdup(path) : NULL;
+  order_cache_extra_tries = extra_tries > 0 ? extra_tries : 0;
+}
+
+// Take a lock on the file guarding the cache (-1 if it cannot be opened)
+int lock_order_cache(int operation) {
+  char *lock_path = (char *)malloc(strlen(order_cache_path) + 6);
+  if (!lock_path) {
+    fprintf(stderr, "Memory allocation failed for lock path\n");
+    return -1;
+  }
+  sprintf(lock_path, "%s.lock", order_cache_path);
+
+  int fd = open(lock_path, O_RDWR | O_CREAT, 0644);
+  free(lock_path);
+  if (fd < 0) {
+    return -1;
+  }
+
+  if (flock(fd, operation) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Release a lock taken by lock_order_cache
+void unlock_order_cache(int fd) {
+  if (fd < 0)
+    return;
+
+  flock(fd, LOCK_UN);
+  close(fd);
+}
+
+// Read all entries of the cache file (the caller holds the lock). Lines
+// that do not parse, such as one left behind by a crashed writer, are
+// skipped so the entries after them survive the next store. A missing file
+// reads as an empty cache. Returns NULL if memory runs out
+OrderCacheEntry *read_order_cache(int *count) {
+  *count = 0;
+  int capacity = 16;
+  OrderCacheEntry *entries =
+      (OrderCacheEntry *)malloc(capacity * sizeof(OrderCacheEntry));
+  if (!entries) {
+    fprintf(stderr, "Memory allocation failed for cache entries\n");
+    return NULL;
+  }
+
+  FILE *file = fopen(order_cache_path, "r");
+  if (!file) {
+    return entries;
+  }
+
+  char line[128];
+  while (fgets(line, sizeof(line), file)) {
+    int complete = strchr(line, '\n') != NULL || feof(file);
+    if (!complete) {
+      // Too long for an entry - skip the rest of the line as well
+      int c;
+      while ((c = fgetc(file)) != EOF && c != '\n') {
+      }
+    }
+
+    if (complete && line[strspn(line, " \t\r\n")] == '\0') {
+      continue; // Blank line
+    }
+
+    OrderCacheEntry entry;
+    if (!complete || sscanf(line, "%llx %26s %d %ld", &entry.fingerprint,
+                            entry.order, &entry.size, &entry.tries) != 4) {
+      fprintf(stderr, "Skipping malformed line in ordering cache %s\n",
+              order_cache_path);
+      continue;
+    }
+
+    if (*count == capacity) {
+      capacity *= 2;
+      OrderCacheEntry *grown = (OrderCacheEntry *)realloc(
+          entries, capacity * sizeof(OrderCacheEntry));
+      if (!grown) {
+        fprintf(stderr, "Memory allocation failed for cache entries\n");
+        free(entries);
+        fclose(file);
+        *count = 0;
+        return NULL;
+      }
+      entries = grown;
+    }
+    entries[(*count)++] = entry;
+  }
+
+  fclose(file);
+  return entries;
+}
+
+// Look up a function in the ordering cache. Returns 1 if it was found
+int order_cache_lookup(unsigned long long fingerprint, OrderCacheEntry *found) {
+  if (!order_cache_path)
+    return 0;
+
+  int fd = lock_order_cache(LOCK_SH);
+  if (fd < 0)
+    return 0;
+
+  int count;
+  int hit = 0;
+  OrderCacheEntry *entries = read_order_cache(&count);
+  for (int i = 0; i < count; i++) {
+    if (entries[i].fingerprint == fingerprint) {
+      *found = entries[i];
+      hit = 1;
+      break;
+    }
+  }
+
+  free(entries);
+  unlock_order_cache(fd);
+  return hit;
+}
+
+// Record a search result. The file is re-read under an exclusive lock, so a
+// better order stored meanwhile by another process is kept, and the tries of
+// both are added up. The new contents replace the file by a rename
+void order_cache_store(unsigned long long fingerprint, const char *order,
+                       int size, long tries) {
+  if (!order_cache_path)
+    return;
+
+  int fd = lock_order_cache(LOCK_EX);
+  if (fd < 0)
+    return;
+
+  // Rewriting the file without its entries would lose them all
+  int count;
+  OrderCacheEntry *entries = read_order_cache(&count);
+  if (!entries) {
+    unlock_order_cache(fd);
+    return;
+  }
+
+  char *temp_path = (char *)malloc(strlen(order_cache_path) + 32);
+  if (!temp_path) {
+    fprintf(stderr, "Memory allocation failed for temporary path\n");
+    free(entries);
+    unlock_order_cache(fd);
+    return;
+  }
+  sprintf(temp_path, "%s.%ld.tmp", order_cache_path, (long)getpid());
+
+  FILE *file = fopen(temp_path, "w");
+  if (file) {
+    int stored = 0;
+    for (int i = 0; i < count; i++) {
+      OrderCacheEntry entry = entries[i];
+      if (entry.fingerprint == fingerprint) {
+        if (size < entry.size) {
+          strcpy(entry.order, order);
+          entry.size = size;
+        }
+        entry.tries += tries;
+        stored = 1;
+      }
+      fprintf(file, "%016llx %s %d %ld\n", entry.fingerprint, entry.order,
+              entry.size, entry.tries);
+    }
+    if (!stored) {
+      fprintf(file, "%016llx %s %d %ld\n", fingerprint, order, size, tries);
+    }
+
+    if (fclose(file) != 0 || rename(temp_path, order_cache_path) != 0) {
+      fprintf(stderr, "Failed to update ordering cache %s\n",
+              order_cache_path);
+      remove(temp_path);
+    }
+  }
+
+  free(temp_path);
+  free(entries);
+  unlock_order_cache(fd);
+}
+
+// Neighbour of an order - two adjacent variables swapped (NULL if it cannot
+// be allocated)
+char *perturb_order(const char *order) {
+  char *result = strdup(order);
+  if (!result) {
+    fprintf(stderr, "Memory allocation failed for ordering\n");
+    return NULL;
+  }
+
+  int length = strlen(result);
+  if (length > 1) {
+    int i = rand() % (length - 1);
+    char temp = result[i];
+    result[i] = result[i + 1];
+    result[i + 1] = temp;
+  }
+
+  return result;
+}
+
+BDD *BDD_create_with_best_order(const char *bfunkcia) {
+  if (!bfunkcia) {
+    fprintf(stderr, "Invalid input parameter\n");
+    return NULL;
+  }
+
+  int num_vars = count_variables(bfunkcia);
+  int min_size = INT_MAX;
+  BDD *best_bdd = NULL;
+  char *best_order = NULL;
+  int tries = num_vars;
+
+  // A function seen before starts from its stored order (a fingerprint of
+  // 0 means it could not be computed)
+  unsigned long long fingerprint = BDD_fingerprint(bfunkcia);
+  OrderCacheEntry cached;
+  int cache_hit = fingerprint != 0 &&
+                  order_cache_lookup(fingerprint, &cached) &&
+                  strlen(cached.order) == (size_t)num_vars;
+  if (cache_hit) {
+    best_order = strdup(cached.order);
+    cache_hit = best_order != NULL;
+  }
+  if (cache_hit) {
+    min_size = cached.size;
+    tries = order_cache_extra_tries;
+  }
+
+  // Try at least num_vars different orderings (or the extra ones on a hit)
+  for (int i = 0; i < tries; i++) {
+    // Generate a new random ordering, or a neighbour of the stored one
+    char *order = cache_hit ? perturb_order(best_order)
+                            : generate_random_order(num_vars);
+    if (!order) {
+      break;
+    }
+
+    // Clean up and re-initialize before each BDD creation
+    if (i > 0) {
+      BDD_reset_system();
+      zero_terminal = create_terminal(0);
+      one_terminal = create_terminal(1);
+      init_unique_table(10000);
+    }
+
+    // Create BDD with this ordering
+    BDD *bdd = BDD_create(bfunkcia, order);
+
+    if (bdd) {
+      // If this is the best BDD so far, remember its size and ordering
+      if (bdd->size < min_size) {
+        min_size = bdd->size;
+
+        // Save the best ordering
+        if (best_order)
+          free(best_order);
+        best_order = strdup(order);
+
+        // Clean up current BDD since we just need its size
+        BDD_free(bdd);
+      } else {
+        // Not the best, clean up
+        BDD_free(bdd);
+      }
+    }
+
+    free(order);
+
+    // Clean up after each iteration
+    BDD_reset_system();
+  }
+
+  if (best_order && fingerprint != 0 && (!cache_hit || tries > 0)) {
+    order_cache_store(fingerprint, best_order, min_size, tries);
+  }
+
+  // Now create the final BDD with the best ordering we found
+  if (best_order) {
+    // Initialize for final BDD creation
+    zero_terminal = create_terminal(0);
+    one_terminal = create_terminal(1);
+    init_unique_table(10000);
+
+    best_bdd = BDD_create(bfunkcia, best_order);
+    free(best_order);
+  }
+
+  return best_bdd;
+}
+
+// Memo entry holding the satisfying-assignment count of one node
+typedef struct CountEntry {
+  Node *node;
+  double count; // Assignments of the levels from node->var downwards
+  struct CountEntry *next;
+} CountEntry;
+
+// Memo table used by the counting and sampling functions
+typedef struct {
+  CountEntry **buckets;
+  int size;
+  int num_vars; // Terminal nodes sit on this level
+} CountTable;
+
+// Level of a node in its BDD (terminal nodes sit below the last variable)
+int node_level(Node *node, int num_vars) {
+  return node->var == -1 ? num_vars : node->var;
+}
+
+// 2^exponent as a double (exact for every exponent we can reach)
+double power_of_two(int exponent) {
+  double result = 1.0;
+  for (int i = 0; i < exponent; i++) {
+    result *= 2.0;
+  }
+  return result;
+}
+
+// Initialize a count table sized for the current unique table (NULL if it
+// cannot be allocated)
+CountTable *create_count_table(int num_vars) {
+  CountTable *table = (CountTable *)malloc(sizeof(CountTable));
+  if (!table) {
+    fprintf(stderr, "Memory allocation failed for count table\n");
+    return NULL;
+  }
+
+  table->size = unique_table.count > 0 ? unique_table.count : 1;
+  table->num_vars = num_vars;
+  table->buckets = (CountEntry **)calloc(table->size, sizeof(CountEntry *));
+  if (!table->buckets) {
+    fprintf(stderr, "Memory allocation failed for count table buckets\n");
+    free(table);
+    return NULL;
+  }
+
+  return table;
+}
+
+// Free a count table and all of its entries
+void free_count_table(CountTable *table) {
+  if (!table)
+    return;
+
+  for (int i = 0; i < table->size; i++) {
+    CountEntry *p = table->buckets[i];
+    while (p != NULL) {
+      CountEntry *next = p->next;
+      free(p);
+      p = next;
+    }
+  }
+
+  free(table->buckets);
+  free(table);
+}
+
+// Look up the memoized count of a node (NULL if not counted yet)
+CountEntry *find_count(CountTable *table, Node *node) {
+  int hash = (int)(((uintptr_t)node >> 4) % (uintptr_t)table->size);
+  for (CountEntry *p = table->buckets[hash]; p != NULL; p = p->next) {
+    if (p->node == node) {
+      return p;
+    }
+  }
+  return NULL;
+}
+
+// Memoize the count of a node whose children are already counted. Returns
+// -1 if the entry cannot be allocated
+int count_node(CountTable *table, Node *node) {
+  double child_count[2];
+  Node *child[2] = {node->low, node->high};
+
+  for (int i = 0; i < 2; i++) {
+    // Levels skipped between a node and its child can take either value
+    int gap = node_level(child[i], table->num_vars) - node->var - 1;
+    double count = child[i]->var == -1 ? (double)child[i]->value
+                                       : find_count(table, child[i])->count;
+    child_count[i] = count * power_of_two(gap);
+  }
+
+  int hash = (int)(((uintptr_t)node >> 4) % (uintptr_t)table->size);
+  CountEntry *entry = (CountEntry *)malloc(sizeof(CountEntry));
+  if (!entry) {
+    fprintf(stderr, "Memory allocation failed for count entry\n");
+    return -1;
+  }
+  entry->node = node;
+  entry->count = child_count[0] + child_count[1];
+  entry->next = table->buckets[hash];
+  table->buckets[hash] = entry;
+  return 0;
+}
+
+// Number of satisfying assignments of the levels node->var .. num_vars - 1
+// (-1 if memory runs out)
+double count_assignments(CountTable *table, Node *node) {
+  if (node->var == -1) {
+    return (double)node->value;
+  }
+
+  CountEntry *known = find_count(table, node);
+  if (known) {
+    return known->count;
+  }
+
+  // Post-order walk on an explicit stack - a node is counted once both of
+  // its children are
+  int capacity = 256;
+  int top = 0;
+  Node **stack = (Node **)malloc(capacity * sizeof(Node *));
+  if (!stack) {
+    fprintf(stderr, "Memory allocation failed for node stack\n");
+    return -1;
+  }
+  stack[top++] = node;
+
+  while (top > 0) {
+    Node *current = stack[top - 1];
+    if (find_count(table, current)) {
+      top--; // Reached through another parent meanwhile
+      continue;
+    }
+
+    if (top + 2 > capacity) {
+      Node **grown = (Node **)realloc(stack, 2 * capacity * sizeof(Node *));
+      if (!grown) {
+        fprintf(stderr, "Memory allocation failed for node stack\n");
+        free(stack);
+        return -1;
+      }
+      stack = grown;
+      capacity *= 2;
+    }
+
+    int ready = 1;
+    if (current->high->var != -1 && !find_count(table, current->high)) {
+      stack[top++] = current->high;
+      ready = 0;
+    }
+    if (current->low->var != -1 && !find_count(table, current->low)) {
+      stack[top++] = current->low;
+      ready = 0;
+    }
+
+    if (ready) {
+      if (count_node(table, current) != 0) {
+        free(stack);
+        return -1;
+      }
+      top--;
+    }
+  }
+
+  free(stack);
+  return find_count(table, node)->count;
+}
+
+// Count the input combinations for which the BDD evaluates to 1 (-1 on
+// error)
+double BDD_satcount(BDD *bdd) {
+  if (!bdd || !bdd->root) {
+    return -1; // Error
+  }
+
+  CountTable *table = create_count_table(bdd->num_vars);
+  if (!table) {
+    return -1;
+  }
+  double count = count_assignments(table, bdd->root);
+  free_count_table(table);
+  if (count < 0) {
+    return -1; // Out of memory
+  }
+
+  return count * power_of_two(node_level(bdd->root, bdd->num_vars));
+}
+
+// Write the per-level bits as an input string in the BDD_use format
+void write_assignment(BDD *bdd, const char *bits, char *vystup) {
+  for (int i = 0; i < bdd->num_vars; i++) {
+    vystup[i] = '0';
+  }
+  vystup[bdd->num_vars] = '\0';
+
+  for (int level = 0; level < bdd->num_vars; level++) {
+    int input_idx = bdd->var_order[level] - 'A';
+    if (input_idx >= 0 && input_idx < bdd->num_vars) {
+      vystup[input_idx] = '0' + bits[level];
+    }
+  }
+}
+
+// Sampler drawing satisfying assignments uniformly at random
+typedef struct BDDSampler {
+  BDD *bdd;
+  CountTable *counts; // Counts are computed once and reused for every sample
+  char *bits;         // Scratch space for the per-level choices
+} BDDSampler;
+
+// Prepare a sampler for the BDD (NULL on error)
+BDDSampler *BDD_sampler_create(BDD *bdd) {
+  if (!bdd || !bdd->root) {
+    return NULL;
+  }
+
+  BDDSampler *sampler = (BDDSampler *)malloc(sizeof(BDDSampler));
+  if (!sampler) {
+    fprintf(stderr, "Memory allocation failed for sampler\n");
+    return NULL;
+  }
+
+  sampler->bdd = bdd;
+  sampler->counts = create_count_table(bdd->num_vars);
+  sampler->bits = (char *)malloc(bdd->num_vars + 1);
+  if (!sampler->counts || !sampler->bits) {
+    if (!sampler->bits)
+      fprintf(stderr, "Memory allocation failed for sampler bits\n");
+    free_count_table(sampler->counts);
+    free(sampler->bits);
+    free(sampler);
+    return NULL;
+  }
+
+  return sampler;
+}
+
+// Draw one satisfying assignment into vystup (num_vars + 1 chars).
+// Returns 1 on success, 0 if the function is unsatisfiable, -1 on error
+int BDD_sampler_next(BDDSampler *sampler, char *vystup) {
+  if (!sampler || !vystup) {
+    return -1; // Error
+  }
+
+  BDD *bdd = sampler->bdd;
+  Node *current = bdd->root;
+
+  if (current->var == -1 && current->value == 0) {
+    return 0;
+  }
+
+  for (int level = 0; level < bdd->num_vars; level++) {
+    if (current->var != level) {
+      // Skipped level - both values lead to the same subfunction
+      sampler->bits[level] = rand() % 2;
+      continue;
+    }
+
+    // Weight each branch by the assignments it covers below this level
+    double low_weight =
+        count_assignments(sampler->counts, current->low) *
+        power_of_two(node_level(current->low, bdd->num_vars) - level - 1);
+    double high_weight =
+        count_assignments(sampler->counts, current->high) *
+        power_of_two(node_level(current->high, bdd->num_vars) - level - 1);
+    if (low_weight < 0 || high_weight < 0) {
+      return -1; // Out of memory
+    }
+
+    double pick = ((double)rand() / ((double)RAND_MAX + 1.0)) *
+                  (low_weight + high_weight);
+
+    if (pick < high_weight) {
+      sampler->bits[level] = 1;
+      current = current->high;
+    } else {
+      sampler->bits[level] = 0;
+      current = current->low;
+    }
+  }
+
+  write_assignment(bdd, sampler->bits, vystup);
+  return 1;
+}
+
+// Free the sampler (the BDD itself is left untouched)
+void BDD_sampler_free(BDDSampler *sampler) {
+  if (!sampler)
+    return;
+
+  free_count_table(sampler->counts);
+  free(sampler->bits);
+  free(sampler);
+}
+
+// Cursor enumerating all satisfying assignments in lexicographic level order
+typedef struct BDDCursor {
+  BDD *bdd;
+  Node **path; // Node reached at each level of the current assignment
+  char *bits;  // Value chosen at each level of the current assignment
+  int started;
+  int done;
+} BDDCursor;
+
+// Prepare a cursor positioned before the first satisfying assignment (NULL
+// on error)
+BDDCursor *BDD_cursor_create(BDD *bdd) {
+  if (!bdd || !bdd->root) {
+    return NULL;
+  }
+
+  BDDCursor *cursor = (BDDCursor *)malloc(sizeof(BDDCursor));
+  if (!cursor) {
+    fprintf(stderr, "Memory allocation failed for cursor\n");
+    return NULL;
+  }
+
+  cursor->bdd = bdd;
+  cursor->path = (Node **)malloc((bdd->num_vars + 1) * sizeof(Node *));
+  cursor->bits = (char *)malloc(bdd->num_vars + 1);
+  if (!cursor->path || !cursor->bits) {
+    fprintf(stderr, "Memory allocation failed for cursor state\n");
+    free(cursor->path);
+    free(cursor->bits);
+    free(cursor);
+    return NULL;
+  }
+  cursor->started = 0;
+  cursor->done = bdd->root->var == -1 && bdd->root->value == 0;
+
+  return cursor;
+}
+
+// Extend the cursor from a level to the smallest satisfying assignment below
+void cursor_descend(BDDCursor *cursor, int level, Node *node) {
+  for (int l = level; l < cursor->bdd->num_vars; l++) {
+    cursor->path[l] = node;
+
+    if (node->var != l) {
+      cursor->bits[l] = 0;
+    } else if (!(node->low->var == -1 && node->low->value == 0)) {
+      cursor->bits[l] = 0;
+      node = node->low;
+    } else {
+      cursor->bits[l] = 1;
+      node = node->high;
+    }
+  }
+}
+
+// Advance to the next satisfying assignment and write it into vystup
+// (num_vars + 1 chars). Returns 1 on success, 0 when exhausted, -1 on error
+int BDD_cursor_next(BDDCursor *cursor, char *vystup) {
+  if (!cursor || !vystup) {
+    return -1; // Error
+  }
+
+  if (cursor->done) {
+    return 0;
+  }
+
+  if (!cursor->started) {
+    cursor->started = 1;
+    cursor_descend(cursor, 0, cursor->bdd->root);
+    write_assignment(cursor->bdd, cursor->bits, vystup);
+    return 1;
+  }
+
+  // Flip the deepest 0 that still has a satisfiable 1-branch
+  for (int level = cursor->bdd->num_vars - 1; level >= 0; level--) {
+    if (cursor->bits[level] != 0) {
+      continue;
+    }
+
+    Node *node = cursor->path[level];
+    Node *child = node;
+    if (node->var == level) {
+      child = node->high;
+      if (child->var == -1 && child->value == 0) {
+        continue;
+      }
+    }
+
+    cursor->bits[level] = 1;
+    cursor_descend(cursor, level + 1, child);
+    write_assignment(cursor->bdd, cursor->bits, vystup);
+    return 1;
+  }
+
+  cursor->done = 1;
+  return 0;
+}
+
+// Free the cursor (the BDD itself is left untouched)
+void BDD_cursor_free(BDDCursor *cursor) {
+  if (!cursor)
+    return;
+
+  free(cursor->path);
+  free(cursor->bits);
+  free(cursor);
+}
+
+// Level of a named variable in the BDD's ordering (-1 if it has none)
+int variable_level(BDD *bdd, char name) {
+  if (name >= 'a' && name <= 'z') {
+    name = name - 'a' + 'A';
+  }
+
+  for (int level = 0; level < bdd->num_vars; level++) {
+    if (bdd->var_order[level] == name) {
+      return level;
+    }
+  }
+  return -1;
+}
+
+// Wrap a root node into a BDD structure sharing the ordering of another BDD
+// (NULL if the operation producing the root ran out of node budget or
+// memory, or the structure cannot be allocated)
+BDD *make_bdd(Node *root, int num_vars, const char *var_order) {
+  if (!root) {
+    return NULL;
+  }
+
+  BDD *bdd = (BDD *)malloc(sizeof(BDD));
+  if (!bdd) {
+    fprintf(stderr, "Memory allocation failed for BDD\n");
+    return NULL;
+  }
+
+  bdd->num_vars = num_vars;
+  bdd->root = root;
+  bdd->terms = NULL;
+  bdd->var_order = strdup(var_order);
+  if (!bdd->var_order) {
+    fprintf(stderr, "Memory allocation failed for variable ordering\n");
+    free(bdd);
+    return NULL;
+  }
+
+  if (update_bdd_size(bdd) != 0) {
+    BDD_free(bdd);
+    return NULL;
+  }
+
+  return bdd;
+}
+
+// Create a cube - the conjunction of the listed variables set to the given
+// values ('0' or '1'). If hodnoty is NULL every variable is taken as '1',
+// which is the form expected by BDD_exists, BDD_forall and BDD_and_exists
+BDD *BDD_cube(BDD *bdd, const char *premenne, const char *hodnoty) {
+  if (!bdd || !premenne ||
+      (hodnoty && strlen(hodnoty) < strlen(premenne))) {
+    fprintf(stderr, "Invalid input parameters\n");
+    return NULL;
+  }
+
+  char values[27] = {0}; // One entry per level (at most 26 variables)
+
+  for (int i = 0; premenne[i] != '\0'; i++) {
+    int level = variable_level(bdd, premenne[i]);
+    char value = hodnoty ? hodnoty[i] : '1';
+    if (level < 0 || (value != '0' && value != '1')) {
+      fprintf(stderr, "Invalid cube variable %c\n", premenne[i]);
+      return NULL;
+    }
+    values[level] = value;
+  }
+
+  Node *curr = create_cube_node(values, bdd->num_vars);
+
+  return make_bdd(curr, bdd->num_vars, bdd->var_order);
+}
+
+// Cofactor f by the literals of a cube
+Node *restrict_node(Node *f, Node *cube) {
+  return run_operation(OP_RESTRICT, f, cube, NULL);
+}
+
+// Quantify the variables of a positive cube out of f. With universal set the
+// two cofactors are combined by AND, otherwise by OR
+Node *quantify_node(Node *f, Node *cube, int universal) {
+  return run_operation(universal ? OP_FORALL : OP_EXISTS, f, cube, NULL);
+}
+
+// Relational product - exists cube . (f AND g), without building f AND g
+Node *and_exists_node(Node *f, Node *g, Node *cube) {
+  return run_operation(OP_AND_EXISTS, f, g, cube);
+}
+
+// Check that two BDDs can be combined (same unique table, compatible order)
+int compatible_bdds(BDD *a, BDD *b) {
+  int common = a->num_vars < b->num_vars ? a->num_vars : b->num_vars;
+  return strncmp(a->var_order, b->var_order, common) == 0;
+}
+
+// Fix the variables of a cube to its values (restriction / cofactor)
+BDD *BDD_restrict(BDD *bdd, BDD *cube) {
+  if (!bdd || !cube || !compatible_bdds(bdd, cube)) {
+    fprintf(stderr, "Invalid input parameters\n");
+    return NULL;
+  }
+
+  return make_bdd(restrict_node(bdd->root, cube->root), bdd->num_vars,
+                  bdd->var_order);
+}
+
+// Existentially quantify the variables of a positive cube
+BDD *BDD_exists(BDD *bdd, BDD *cube) {
+  if (!bdd || !cube || !compatible_bdds(bdd, cube)) {
+    fprintf(stderr, "Invalid input parameters\n");
+    return NULL;
+  }
+
+  return make_bdd(quantify_node(bdd->root, cube->root, 0), bdd->num_vars,
+                  bdd->var_order);
+}
+
+// Universally quantify the variables of a positive cube
+BDD *BDD_forall(BDD *bdd, BDD *cube) {
+  if (!bdd || !cube || !compatible_bdds(bdd, cube)) {
+    fprintf(stderr, "Invalid input parameters\n");
+    return NULL;
+  }
+
+  return make_bdd(quantify_node(bdd->root, cube->root, 1), bdd->num_vars,
+                  bdd->var_order);
+}
+
+// Conjoin two BDDs and existentially quantify the variables of a positive
+// cube in one pass, so the full conjunction is never materialized
+BDD *BDD_and_exists(BDD *f, BDD *g, BDD *cube) {
+  if (!f || !g || !cube || !compatible_bdds(f, g) ||
+      !compatible_bdds(f, cube) || !compatible_bdds(g, cube)) {
+    fprintf(stderr, "Invalid input parameters\n");
+    return NULL;
+  }
+
+  BDD *wider = f->num_vars >= g->num_vars ? f : g;
+  return make_bdd(and_exists_node(f->root, g->root, cube->root),
+                  wider->num_vars, wider->var_order);
+}
+
+// Reference to the result of a breadth-first request - a finished node, or
+// a request on a deeper level
+typedef struct {
+  Node *node; // NULL while the result is a request
+  int level;
+  int index;
+} RequestRef;
+
+// One apply request of the breadth-first engine
+typedef struct {
+  Node *f;
+  Node *g;
+  RequestRef low;  // Request for the low cofactors
+  RequestRef high; // Request for the high cofactors
+} Request;
+
+// All requests of one variable level
+typedef struct {
+  Request *requests;
+  int count;
+  int capacity;
+  int *slots;        // (f, g) -> index + 1, while the level takes requests
+  int slot_capacity; // Power of two (0 once the slots are freed)
+  Node **results;    // Results of the requests, filled bottom up
+  long file_offset;  // Position of the spilled requests (-1 if in memory)
+} RequestLevel;
+
+// State of one breadth-first apply
+typedef struct {
+  int op;
+  RequestLevel *levels;
+  int level_count;
+  FILE *spill;     // Temporary file for spilled levels (opened on demand)
+  long in_memory;  // Requests currently held in memory
+  int failed;      // Set once the node budget or memory runs out
+} BreadthFirstApply;
+
+// Requests the breadth-first apply keeps in memory before it starts to
+// spill finished levels to a temporary file
+long breadth_first_memory_limit = 1000000;
+
+// Set how many requests the breadth-first apply may keep in memory
+void BDD_set_breadth_first_memory(long requests) {
+  breadth_first_memory_limit = requests > 0 ? requests : 1;
+}
+
+// Get a level of the breadth-first apply, adding levels as needed (NULL if
+// they cannot be allocated)
+RequestLevel *request_level(BreadthFirstApply *state, int level) {
+  if (level >= state->level_count) {
+    int count = level + 1;
+    RequestLevel *levels = (RequestLevel *)realloc(
+        state->levels, count * sizeof(RequestLevel));
+    if (!levels) {
+      fprintf(stderr, "Memory allocation failed for request levels\n");
+      return NULL;
+    }
+    state->levels = levels;
+    memset(&state->levels[state->level_count], 0,
+           (count - state->level_count) * sizeof(RequestLevel));
+    for (int i = state->level_count; i < count; i++) {
+      state->levels[i].file_offset = -1;
+    }
+    state->level_count = count;
+  }
+
+  return &state->levels[level];
+}
+
+// Hash slot of an operand pair within a level
+int request_slot(RequestLevel *level, Node *f, Node *g) {
+  unsigned long hash = (unsigned long)f * 1009 + (unsigned long)g * 10007;
+  return (int)((hash >> 4) & (level->slot_capacity - 1));
+}
+
+// Rebuild the hash slots of a level with twice the capacity. Returns -1
+// (keeping the old slots) if they cannot be allocated
+int grow_request_slots(RequestLevel *level) {
+  int capacity = level->slot_capacity ? level->slot_capacity * 2 : 64;
+  int *slots = (int *)calloc(capacity, sizeof(int));
+  if (!slots) {
+    fprintf(stderr, "Memory allocation failed for request slots\n");
+    return -1;
+  }
+  free(level->slots);
+  level->slots = slots;
+  level->slot_capacity = capacity;
+
+  for (int i = 0; i < level->count; i++) {
+    Request *request = &level->requests[i];
+    int slot = request_slot(level, request->f, request->g);
+    while (level->slots[slot] != 0) {
+      slot = (slot + 1) & (level->slot_capacity - 1);
+    }
+    level->slots[slot] = i + 1;
+  }
+  return 0;
+}
+
+// Reference the result of op(f, g) - a node for the terminal and cached
+// cases, otherwise the (possibly new) request on the operands' top level.
+// Sets state->failed if the request cannot be stored
+RequestRef request_ref(BreadthFirstApply *state, Node *f, Node *g) {
+  RequestRef ref;
+  ref.node = apply_shortcut(state->op, &f, &g);
+  if (ref.node) {
+    return ref;
+  }
+
+  ref.level = (f->var < g->var) ? f->var : g->var;
+  ref.index = 0;
+  RequestLevel *level = request_level(state, ref.level);
+  if (!level) {
+    state->failed = 1;
+    return ref;
+  }
+
+  if (2 * (level->count + 1) > level->slot_capacity &&
+      grow_request_slots(level) != 0) {
+    state->failed = 1;
+    return ref;
+  }
+
+  // Look for the same request on this level
+  int slot = request_slot(level, f, g);
+  while (level->slots[slot] != 0) {
+    Request *request = &level->requests[level->slots[slot] - 1];
+    if (request->f == f && request->g == g) {
+      ref.index = level->slots[slot] - 1;
+      return ref;
+    }
+    slot = (slot + 1) & (level->slot_capacity - 1);
+  }
+
+  if (level->count == level->capacity) {
+    int capacity = level->capacity ? level->capacity * 2 : 64;
+    Request *requests =
+        (Request *)realloc(level->requests, capacity * sizeof(Request));
+    if (!requests) {
+      fprintf(stderr, "Memory allocation failed for requests\n");
+      state->failed = 1;
+      return ref;
+    }
+    level->requests = requests;
+    level->capacity = capacity;
+  }
+
+  ref.index = level->count++;
+  level->requests[ref.index].f = f;
+  level->requests[ref.index].g = g;
+  level->slots[slot] = ref.index + 1;
+  state->in_memory++;
+
+  return ref;
+}
+
+// Write the requests of a finished level to the temporary file
+void spill_level(BreadthFirstApply *state, RequestLevel *level) {
+  if (!state->spill) {
+    state->spill = tmpfile();
+    if (!state->spill) {
+      return; // Keep everything in memory
+    }
+  }
+
+  fseek(state->spill, 0, SEEK_END);
+  long offset = ftell(state->spill);
+  if (offset < 0 || fwrite(level->requests, sizeof(Request), level->count,
+                           state->spill) != (size_t)level->count) {
+    return; // Keep the level in memory
+  }
+
+  level->file_offset = offset;
+  free(level->requests);
+  level->requests = NULL;
+  state->in_memory -= level->count;
+}
+
+// Read the spilled requests of a level back. Returns -1 if they cannot be
+// allocated or read
+int load_level(BreadthFirstApply *state, RequestLevel *level) {
+  level->requests = (Request *)malloc(level->count * sizeof(Request));
+  if (!level->requests) {
+    fprintf(stderr, "Memory allocation failed for requests\n");
+    return -1;
+  }
+
+  fseek(state->spill, level->file_offset, SEEK_SET);
+  if (fread(level->requests, sizeof(Request), level->count, state->spill) !=
+      (size_t)level->count) {
+    fprintf(stderr, "Failed to read spilled requests\n");
+    return -1;
+  }
+  return 0;
+}
+
+// Node a reference stands for (deeper levels are already reduced)
+Node *resolve_request(BreadthFirstApply *state, RequestRef ref) {
+  return ref.node ? ref.node : state->levels[ref.level].results[ref.index];
+}
+
+// Apply OR / AND one variable level at a time: all requests of a level are
+// expanded together top down, then reduced together bottom up, so the
+// request queues are streamed instead of chased through the call stack.
+// Returns NULL if the node budget or memory runs out
+Node *breadth_first_apply(int op, Node *f, Node *g) {
+  BreadthFirstApply state;
+  state.op = op;
+  state.levels = NULL;
+  state.level_count = 0;
+  state.spill = NULL;
+  state.in_memory = 0;
+  state.failed = 0;
+
+  RequestRef root = request_ref(&state, f, g);
+  if (root.node) {
+    return root.node;
+  }
+
+  // Expansion - children of a level's requests always land on deeper levels
+  for (int v = root.level; v < state.level_count && !state.failed; v++) {
+    for (int i = 0; i < state.levels[v].count && !state.failed; i++) {
+      Request request = state.levels[v].requests[i];
+      Node *f_low = (request.f->var == v) ? request.f->low : request.f;
+      Node *f_high = (request.f->var == v) ? request.f->high : request.f;
+      Node *g_low = (request.g->var == v) ? request.g->low : request.g;
+      Node *g_high = (request.g->var == v) ? request.g->high : request.g;
+
+      // request_ref may move the levels, so store through the index
+      RequestRef low = request_ref(&state, f_low, g_low);
+      RequestRef high = request_ref(&state, f_high, g_high);
+      state.levels[v].requests[i].low = low;
+      state.levels[v].requests[i].high = high;
+    }
+
+    RequestLevel *level = &state.levels[v];
+    free(level->slots);
+    level->slots = NULL;
+    level->slot_capacity = 0;
+
+    if (level->count > 0 && state.in_memory > breadth_first_memory_limit) {
+      spill_level(&state, level);
+    }
+  }
+
+  // Reduction - deepest level first, so every child is already a node
+  for (int v = state.level_count - 1; v >= root.level && !state.failed;
+       v--) {
+    RequestLevel *level = &state.levels[v];
+    if (level->count == 0)
+      continue;
+
+    if (level->file_offset >= 0 && load_level(&state, level) != 0) {
+      state.failed = 1;
+      break;
+    }
+
+    level->results = (Node **)malloc(level->count * sizeof(Node *));
+    if (!level->results) {
+      fprintf(stderr, "Memory allocation failed for request results\n");
+      state.failed = 1;
+      break;
+    }
+
+    for (int i = 0; i < level->count; i++) {
+      Request *request = &level->requests[i];
+      Node *result =
+          find_or_add_node(v, resolve_request(&state, request->low),
+                           resolve_request(&state, request->high));
+      if (result == NULL) {
+        state.failed = 1; // Out of node budget
+        break;
+      }
+      level->results[i] = result;
+      cache_insert(op, request->f, request->g, NULL, result);
+    }
+
+    free(level->requests);
+    level->requests = NULL;
+  }
+
+  Node *result = state.failed ? NULL : resolve_request(&state, root);
+
+  for (int v = 0; v < state.level_count; v++) {
+    free(state.levels[v].requests);
+    free(state.levels[v].slots);
+    free(state.levels[v].results);
+  }
+  free(state.levels);
+  if (state.spill) {
+    fclose(state.spill);
+  }
+
+  return result;
+}
+
+// Combine two BDDs by OR (op = OP_OR) or AND (op = OP_AND) with the
+// breadth-first engine, meant for diagrams too large for depth-first apply
+BDD *BDD_apply_breadth_first(BDD *f, BDD *g, int op) {
+  if (!f || !g || (op != OP_OR && op != OP_AND) || !compatible_bdds(f, g)) {
+    fprintf(stderr, "Invalid input parameters\n");
+    return NULL;
+  }
+
+  BDD *wider = f->num_vars >= g->num_vars ? f : g;
+  return make_bdd(breadth_first_apply(op, f->root, g->root), wider->num_vars,
+                  wider->var_order);
+}
+
+// Approximation methods for BDD_approximate
+enum {
+  APPROX_HEAVY_BRANCH, // Keep the branches covering the most minterms
+  APPROX_SHORT_PATH,   // Keep the paths to 1 that test the fewest variables
+  APPROX_REMAP         // Replace nodes by a contained child, then as above
+};
+
+// Minterms of the levels node->var .. num_vars - 1 reached through a child
+// (negative if memory runs out)
+double branch_weight(CountTable *counts, Node *node, Node *child) {
+  return count_assignments(counts, child) *
+         power_of_two(node_level(child, counts->num_vars) - node->var - 1);
+}
+
+// Pending subset_node call on its explicit stack
+typedef struct {
+  Node *f;
+  int budget;
+  int state;   // 0 = expand, 1 = heavy branch done, 2 = light branch done
+  Node *heavy; // Branch covering more minterms, approximated first
+  Node *light;
+  Node *heavy_result;
+} SubsetFrame;
+
+// Push a subset_node call. Returns -1 if the stack cannot grow
+int push_subset_frame(SubsetFrame **frames, int *count, int *capacity,
+                      Node *f, int budget) {
+  if (*count == *capacity) {
+    int grown_capacity = *capacity * 2;
+    SubsetFrame *grown = (SubsetFrame *)realloc(
+        *frames, grown_capacity * sizeof(SubsetFrame));
+    if (!grown) {
+      fprintf(stderr, "Memory allocation failed for subset stack\n");
+      return -1;
+    }
+    *frames = grown;
+    *capacity = grown_capacity;
+  }
+
+  SubsetFrame *frame = &(*frames)[(*count)++];
+  frame->f = f;
+  frame->budget = budget;
+  frame->state = 0;
+  return 0;
+}
+
+// Result of subset_node that needs no split (NULL if f has to be split).
+// With remap set, a node whose one branch is contained in the other is first
+// replaced by that branch; *failed is set if the node budget or memory runs
+// out
+Node *subset_shortcut(Node **f_operand, int budget, CountTable *counts,
+                      int remap, int *failed) {
+  for (;;) {
+    Node *f = *f_operand;
+    if (f->var == -1)
+      return f;
+    if (budget <= 0)
+      return create_terminal(0);
+
+    int size = subgraph_size(f);
+    if (size < 0) {
+      *failed = 1;
+      return NULL;
+    }
+    if (size <= budget)
+      return f;
+    if (!remap)
+      return NULL;
+
+    // ite(x, high, low) shrinks to a branch contained in the other one and
+    // stays a subset. It drops this node and everything only the other
+    // branch needs, so take it when it keeps at least half of the minterms
+    double low_weight = branch_weight(counts, f, f->low);
+    double high_weight = branch_weight(counts, f, f->high);
+    Node *both = apply_and(f->low, f->high);
+    if (low_weight < 0 || high_weight < 0 || both == NULL) {
+      *failed = 1;
+      return NULL;
+    }
+
+    if (both == f->low && 2 * low_weight >= high_weight) {
+      *f_operand = f->low;
+    } else if (both == f->high && 2 * high_weight >= low_weight) {
+      *f_operand = f->high;
+    } else {
+      return NULL;
+    }
+  }
+}
+
+// Under-approximate f with at most budget nodes. Whole subgraphs are kept
+// while they fit; otherwise the heavier branch gets the budget first and the
+// lighter one what is left. With remap set, a node whose one branch is
+// contained in the other is first replaced by that branch. Runs on an
+// explicit stack, since the light branch's budget depends on the heavy
+// branch's result. Returns NULL if the node budget or memory runs out
+Node *subset_node(Node *f, int budget, CountTable *counts, int remap) {
+  int capacity = 64;
+  int count = 0;
+  SubsetFrame *frames = (SubsetFrame *)malloc(capacity * sizeof(SubsetFrame));
+  if (!frames) {
+    fprintf(stderr, "Memory allocation failed for subset stack\n");
+    return NULL;
+  }
+  push_subset_frame(&frames, &count, &capacity, f, budget);
+
+  Node *value = NULL; // Result of the frame finished last
+  while (count > 0) {
+    SubsetFrame *frame = &frames[count - 1];
+
+    if (frame->state == 0) {
+      int failed = 0;
+      value = subset_shortcut(&frame->f, frame->budget, counts, remap, &failed);
+      if (failed)
+        break;
+      if (value) {
+        count--;
+        continue;
+      }
+
+      Node *node = frame->f;
+      double low_weight = branch_weight(counts, node, node->low);
+      double high_weight = branch_weight(counts, node, node->high);
+      if (low_weight < 0 || high_weight < 0) {
+        value = NULL;
+        break;
+      }
+      frame->heavy = high_weight >= low_weight ? node->high : node->low;
+      frame->light = high_weight >= low_weight ? node->low : node->high;
+      frame->state = 1;
+      if (push_subset_frame(&frames, &count, &capacity, frame->heavy,
+                            frame->budget - 1) != 0) {
+        value = NULL;
+        break;
+      }
+    } else if (frame->state == 1) {
+      if (value == NULL)
+        break;
+      frame->heavy_result = value;
+      frame->state = 2;
+
+      int heavy_size = subgraph_size(value);
+      int left = frame->budget - 1 - heavy_size;
+      if (heavy_size < 0 || push_subset_frame(&frames, &count, &capacity,
+                                              frame->light, left) != 0) {
+        value = NULL;
+        break;
+      }
+    } else {
+      if (value == NULL)
+        break;
+
+      Node *node = frame->f;
+      value = frame->heavy == node->high
+                  ? find_or_add_node(node->var, value, frame->heavy_result)
+                  : find_or_add_node(node->var, frame->heavy_result, value);
+      count--;
+      if (value == NULL)
+        break;
+    }
+  }
+
+  free(frames);
+  return value;
+}
+
+// Under-approximate f with at most max_nodes nodes using a method (NULL if
+// the node budget or memory runs out)
+Node *approximate_node(Node *f, int num_vars, int method, int max_nodes) {
+  if (method == APPROX_SHORT_PATH) {
+    // Allow ever longer paths until the result no longer fits
+    Node *best = create_terminal(0);
+    for (int depth = 1; depth <= num_vars; depth++) {
+      NodeMap *memo = create_node_map();
+      Node *candidate =
+          run_transform(TRANSFORM_SHORT_PATH, f, depth, 0, memo);
+      free_node_map(memo);
+
+      if (candidate == NULL)
+        return NULL;
+      int size = subgraph_size(candidate);
+      if (size < 0)
+        return NULL;
+      if (size > max_nodes)
+        break;
+      best = candidate;
+    }
+    return best;
+  }
+
+  CountTable *counts = create_count_table(num_vars);
+  if (!counts)
+    return NULL;
+  Node *result = subset_node(f, max_nodes, counts, method == APPROX_REMAP);
+  free_count_table(counts);
+  return result;
+}
+
+// Approximate the BDD with at most max_nodes nodes. The result is a subset
+// of the function (over = 0) or a superset of it (over = 1, computed as the
+// complement of the under-approximated complement). If retained is not
+// NULL it receives the share of the onset kept (under) or the share of the
+// result's onset that belongs to the function (over), 1.0 meaning exact
+BDD *BDD_approximate(BDD *bdd, int method, int max_nodes, int over,
+                     double *retained) {
+  if (!bdd || !bdd->root || max_nodes < 0 ||
+      (method != APPROX_HEAVY_BRANCH && method != APPROX_SHORT_PATH &&
+       method != APPROX_REMAP)) {
+    fprintf(stderr, "Invalid input parameters\n");
+    return NULL;
+  }
+
+  Node *f = bdd->root;
+  if (over) {
+    f = run_operation(OP_NOT, f, NULL, NULL);
+  }
+
+  Node *result = f ? approximate_node(f, bdd->num_vars, method, max_nodes)
+                   : NULL;
+  if (over && result) {
+    result = run_operation(OP_NOT, result, NULL, NULL);
+  }
+
+  BDD *approximation = make_bdd(result, bdd->num_vars, bdd->var_order);
+  if (approximation && retained) {
+    double original = BDD_satcount(bdd);
+    double approximated = BDD_satcount(approximation);
+    if (original < 0 || approximated < 0) {
+      BDD_free(approximation);
+      return NULL; // Out of memory
+    }
+    double larger = over ? approximated : original;
+    double smaller = over ? original : approximated;
+    *retained = larger > 0 ? smaller / larger : 1.0;
+  }
+
+  return approximation;
+}
+
+// ZDD structure - a family of sets of variables, stored in the shared
+// unique table as a zero-suppressed decision diagram
+typedef struct ZDD {
+  int num_vars;    // Number of variables
+  int size;        // Number of nodes
+  Node *root;      // Root node
+  char *var_order; // Variable ordering
+} ZDD;
+
+// Wrap a root node into a ZDD structure (NULL if the operation producing
+// the root ran out of node budget or memory, or the structure cannot be
+// allocated)
+ZDD *make_zdd(Node *root, int num_vars, const char *var_order) {
+  if (!root) {
+    return NULL;
+  }
+
+  ZDD *zdd = (ZDD *)malloc(sizeof(ZDD));
+  if (!zdd) {
+    fprintf(stderr, "Memory allocation failed for ZDD\n");
+    return NULL;
+  }
+
+  zdd->num_vars = num_vars;
+  zdd->root = root;
+  zdd->size = subgraph_size(root);
+  zdd->var_order = strdup(var_order);
+  if (!zdd->var_order || zdd->size < 0) {
+    if (!zdd->var_order)
+      fprintf(stderr, "Memory allocation failed for variable ordering\n");
+    free(zdd->var_order);
+    free(zdd);
+    return NULL;
+  }
+
+  return zdd;
+}
+
+// Free the ZDD
+void ZDD_free(ZDD *zdd) {
+  if (!zdd)
+    return;
+
+  free(zdd->var_order);
+  free(zdd);
+}
+
+// Create the family of the product terms of a Boolean function, each term
+// taken as the set of its variables. A ZDD only stores nodes for variables a
+// set contains, so a sparse cover takes far fewer nodes than its BDD
+ZDD *ZDD_create(const char *bfunkcia, const char *poradie) {
+  int num_vars = prepare_function(bfunkcia, poradie);
+  if (num_vars < 0) {
+    return NULL;
+  }
+
+  Node *root = create_terminal(0);
+  int position = 0;
+  int start;
+  int length;
+  while (root != NULL &&
+         (start = next_term(bfunkcia, &position, &length)) >= 0) {
+    // The positive cube of a term is also the ZDD of the single set of its
+    // variables - both skip every level the term does not contain
+    Node *term = create_term_bdd(bfunkcia + start, length, poradie, num_vars);
+    if (!term) {
+      return NULL;
+    }
+    root = run_operation(OP_ZDD_UNION, root, term, NULL);
+  }
+
+  return make_zdd(root, num_vars, poradie);
+}
+
+// Check that two ZDDs order their common variables the same way
+int compatible_zdds(ZDD *a, ZDD *b) {
+  int common = a->num_vars < b->num_vars ? a->num_vars : b->num_vars;
+  return strncmp(a->var_order, b->var_order, common) == 0;
+}
+
+// Pending zdd_product call on its explicit stack
+typedef struct {
+  Node *p;
+  Node *q;
+  int var;
+  int state;      // Number of partial products started
+  Node *p_low;    // Cofactors on var - [0] low, [1] high
+  Node *p_high;
+  Node *q_low;
+  Node *q_high;
+  Node *parts[4]; // p0*q0, p1*q1, p1*q0, p0*q1
+} ProductFrame;
+
+// Push a zdd_product call. Returns -1 if the stack cannot grow
+int push_product_frame(ProductFrame **frames, int *count, int *capacity,
+                       Node *p, Node *q) {
+  if (*count == *capacity) {
+    int grown_capacity = *capacity * 2;
+    ProductFrame *grown = (ProductFrame *)realloc(
+        *frames, grown_capacity * sizeof(ProductFrame));
+    if (!grown) {
+      fprintf(stderr, "Memory allocation failed for product stack\n");
+      return -1;
+    }
+    *frames = grown;
+    *capacity = grown_capacity;
+  }
+
+  ProductFrame *frame = &(*frames)[(*count)++];
+  frame->p = p;
+  frame->q = q;
+  frame->state = 0;
+  return 0;
+}
+
+// Terminal and cached cases of the product. Returns NULL if the operands
+// have to be split, with *p and *q put in canonical order
+Node *product_shortcut(Node **p_operand, Node **q_operand) {
+  Node *p = *p_operand;
+  Node *q = *q_operand;
+
+  // The 1-terminal is the family holding the empty set
+  if ((p->var == -1 && p->value == 0) || (q->var == -1 && q->value == 0))
+    return create_terminal(0);
+  if (p->var == -1)
+    return q;
+  if (q->var == -1)
+    return p;
+
+  if (p > q) {
+    *p_operand = q;
+    *q_operand = p;
+  }
+  return cache_lookup(OP_ZDD_PRODUCT, *p_operand, *q_operand, NULL);
+}
+
+// Cross product of two families - every union of a set of p with a set of
+// q. Sets with the top variable come from the pairs where at least one side
+// contains it, so a node needs four partial products. Runs on an explicit
+// stack and returns NULL if the node budget or memory runs out
+Node *zdd_product(Node *p, Node *q) {
+  int capacity = 64;
+  int count = 0;
+  ProductFrame *frames =
+      (ProductFrame *)malloc(capacity * sizeof(ProductFrame));
+  if (!frames) {
+    fprintf(stderr, "Memory allocation failed for product stack\n");
+    return NULL;
+  }
+  push_product_frame(&frames, &count, &capacity, p, q);
+
+  Node *value = NULL; // Result of the frame finished last
+  while (count > 0) {
+    ProductFrame *frame = &frames[count - 1];
+
+    if (frame->state == 0) {
+      value = product_shortcut(&frame->p, &frame->q);
+      if (value) {
+        count--;
+        continue;
+      }
+
+      Node *f = frame->p;
+      Node *g = frame->q;
+      frame->var = (f->var < g->var) ? f->var : g->var;
+      frame->p_low = (f->var == frame->var) ? f->low : f;
+      frame->p_high = (f->var == frame->var) ? f->high : create_terminal(0);
+      frame->q_low = (g->var == frame->var) ? g->low : g;
+      frame->q_high = (g->var == frame->var) ? g->high : create_terminal(0);
+    } else {
+      if (value == NULL)
+        break;
+      frame->parts[frame->state - 1] = value;
+    }
+
+    if (frame->state < 4) {
+      int part = frame->state++;
+      Node *p_part = (part == 0 || part == 3) ? frame->p_low : frame->p_high;
+      Node *q_part = (part == 0 || part == 2) ? frame->q_low : frame->q_high;
+      if (push_product_frame(&frames, &count, &capacity, p_part, q_part) !=
+          0) {
+        value = NULL;
+        break;
+      }
+      continue;
+    }
 
-  // Reset terminal nodes
-  if (zero_terminal != NULL) {
-    free(zero_terminal);
-    zero_terminal = NULL;
+    Node *high =
+        run_operation(OP_ZDD_UNION, frame->parts[1], frame->parts[2], NULL);
+    high = high ? run_operation(OP_ZDD_UNION, high, frame->parts[3], NULL)
+                : NULL;
+    value = high ? zdd_node(frame->var, frame->parts[0], high) : NULL;
+    if (value == NULL)
+      break;
+    cache_insert(OP_ZDD_PRODUCT, frame->p, frame->q, NULL, value);
+    count--;
   }
 
-  if (one_terminal != NULL) {
-    free(one_terminal);
-    one_terminal = NULL;
-  }
+  free(frames);
+  return value;
 }
 
-BDD *BDD_create_with_best_order(const char *bfunkcia) {
-  if (!bfunkcia) {
-    fprintf(stderr, "Invalid input parameter\n");
+// Apply a set operation (OP_ZDD_UNION, OP_ZDD_INTERSECT, OP_ZDD_DIFF or
+// OP_ZDD_PRODUCT) to two ZDDs
+ZDD *zdd_apply(ZDD *p, ZDD *q, int op) {
+  if (!p || !q || !compatible_zdds(p, q)) {
+    fprintf(stderr, "Invalid input parameters\n");
     return NULL;
   }
 
-  int num_vars = count_variables(bfunkcia);
-  int min_size = INT_MAX;
-  BDD *best_bdd = NULL;
-  char *best_order = NULL;
+  Node *root = op == OP_ZDD_PRODUCT
+                   ? zdd_product(p->root, q->root)
+                   : run_operation(op, p->root, q->root, NULL);
 
-  // Try at least num_vars different orderings
-  for (int i = 0; i < num_vars; i++) {
-    // Generate a new random ordering
-    char *order = generate_random_order(num_vars);
+  ZDD *wider = p->num_vars >= q->num_vars ? p : q;
+  return make_zdd(root, wider->num_vars, wider->var_order);
+}
 
-    // Clean up and re-initialize before each BDD creation
-    if (i > 0) {
-      BDD_reset_system();
-      zero_terminal = create_terminal(0);
-      one_terminal = create_terminal(1);
-      init_unique_table(10000);
-    }
+// Sets in p or in q
+ZDD *ZDD_union(ZDD *p, ZDD *q) { return zdd_apply(p, q, OP_ZDD_UNION); }
 
-    // Create BDD with this ordering
-    BDD *bdd = BDD_create(bfunkcia, order);
+// Sets in both p and q
+ZDD *ZDD_intersect(ZDD *p, ZDD *q) {
+  return zdd_apply(p, q, OP_ZDD_INTERSECT);
+}
 
-    if (bdd) {
-      // If this is the best BDD so far, remember its size and ordering
-      if (bdd->size < min_size) {
-        min_size = bdd->size;
+// Sets in p but not in q
+ZDD *ZDD_difference(ZDD *p, ZDD *q) { return zdd_apply(p, q, OP_ZDD_DIFF); }
 
-        // Save the best ordering
-        if (best_order)
-          free(best_order);
-        best_order = strdup(order);
+// Unions of a set of p with a set of q
+ZDD *ZDD_product(ZDD *p, ZDD *q) { return zdd_apply(p, q, OP_ZDD_PRODUCT); }
 
-        // Clean up current BDD since we just need its size
-        BDD_free(bdd);
-      } else {
-        // Not the best, clean up
-        BDD_free(bdd);
-      }
-    }
+// Family of the satisfying assignments of a BDD, each as the set of the
+// variables set to 1
+ZDD *ZDD_from_bdd(BDD *bdd) {
+  if (!bdd || !bdd->root) {
+    fprintf(stderr, "Invalid input parameters\n");
+    return NULL;
+  }
 
-    free(order);
+  NodeMap *memo = create_node_map();
+  Node *root =
+      run_transform(TRANSFORM_BDD_TO_ZDD, bdd->root, 0, bdd->num_vars, memo);
+  free_node_map(memo);
 
-    // Clean up after each iteration
-    BDD_reset_system();
+  return make_zdd(root, bdd->num_vars, bdd->var_order);
+}
+
+// Characteristic function of a family - the BDD satisfied exactly by the
+// assignments whose set of variables set to 1 is in the family
+BDD *BDD_from_zdd(ZDD *zdd) {
+  if (!zdd || !zdd->root) {
+    fprintf(stderr, "Invalid input parameters\n");
+    return NULL;
   }
 
-  // Now create the final BDD with the best ordering we found
-  if (best_order) {
-    // Initialize for final BDD creation
-    zero_terminal = create_terminal(0);
-    one_terminal = create_terminal(1);
-    init_unique_table(10000);
+  NodeMap *memo = create_node_map();
+  Node *root =
+      run_transform(TRANSFORM_ZDD_TO_BDD, zdd->root, 0, zdd->num_vars, memo);
+  free_node_map(memo);
 
-    best_bdd = BDD_create(bfunkcia, best_order);
-    free(best_order);
+  return make_bdd(root, zdd->num_vars, zdd->var_order);
+}
+
+// Boolean function of a family read as a sum of products (the inverse of
+// ZDD_create)
+BDD *BDD_from_zdd_cover(ZDD *zdd) {
+  if (!zdd || !zdd->root) {
+    fprintf(stderr, "Invalid input parameters\n");
+    return NULL;
   }
 
-  return best_bdd;
+  NodeMap *memo = create_node_map();
+  Node *root = run_transform(TRANSFORM_ZDD_COVER, zdd->root, 0, 0, memo);
+  free_node_map(memo);
+
+  return make_bdd(root, zdd->num_vars, zdd->var_order);
 }
 
 // Modified test_bdd function to properly clean up all memory
@@ -679,6 +4050,604 @@ void test_bdd() {
     BDD_reset_system();
   }
 
+  // Test that sampling is uniform over the solutions of A+BC - the A = 1
+  // branch skips the levels of B and C, which must still be drawn evenly
+  {
+    const char *orders[2] = {"ABC", "CBA"};
+    const int samples = 10000;
+    int errors = 0;
+
+    for (int o = 0; o < 2; o++) {
+      init_unique_table(10000);
+      BDD *bdd = BDD_create("A+BC", orders[o]);
+      BDDSampler *sampler = BDD_sampler_create(bdd);
+      double solutions = BDD_satcount(bdd);
+      if (!bdd || !sampler || solutions != 5) {
+        printf("Error: cannot sample A+BC with order %s\n", orders[o]);
+        errors++;
+        BDD_sampler_free(sampler);
+        BDD_free(bdd);
+        BDD_reset_system();
+        continue;
+      }
+
+      // Count each assignment, indexed by its bits read as a binary number
+      int counts[8] = {0};
+      char assignment[4];
+      for (int j = 0; j < samples; j++) {
+        if (BDD_sampler_next(sampler, assignment) != 1) {
+          errors++;
+          break;
+        }
+        counts[(assignment[0] - '0') * 4 + (assignment[1] - '0') * 2 +
+               (assignment[2] - '0')]++;
+      }
+
+      // Expect samples / 5 = 2000 each; 300 is more than 7 standard
+      // deviations, so a fair sampler does not fail by chance
+      for (int index = 0; index < 8; index++) {
+        int is_solution = index >= 4 || index == 3;
+        int expected = is_solution ? (int)(samples / solutions) : 0;
+        if (counts[index] < expected - 300 || counts[index] > expected + 300) {
+          printf("Error: order %s, assignment %d%d%d sampled %d times, "
+                 "expected about %d\n",
+                 orders[o], index >> 2, (index >> 1) & 1, index & 1,
+                 counts[index], expected);
+          errors++;
+        }
+      }
+
+      BDD_sampler_free(sampler);
+      BDD_free(bdd);
+      BDD_reset_system();
+    }
+
+    printf("Sampling test completed with %d errors\n\n", errors);
+  }
+
+  // Test restriction and quantification against brute-force evaluation
+  {
+    const int num_vars = 5;
+    int errors = 0;
+
+    for (int i = 0; i < 10; i++) {
+      char *f_function = generate_random_boolean_function(num_vars, 3);
+      char *g_function = generate_random_boolean_function(num_vars, 3);
+
+      // Make both functions span all variables so they share one ordering
+      char *f_full = (char *)malloc(strlen(f_function) + 8);
+      char *g_full = (char *)malloc(strlen(g_function) + 8);
+      if (!f_full || !g_full) {
+        fprintf(stderr, "Memory allocation failed for test functions\n");
+        exit(1);
+      }
+      sprintf(f_full, "%s+ABCDE", f_function);
+      sprintf(g_full, "%s+ABCDE", g_function);
+
+      init_unique_table(10000);
+      BDD *f = BDD_create(f_full, "ABCDE");
+      BDD *g = BDD_create(g_full, "ABCDE");
+      BDD *fixed = BDD_cube(f, "BD", "01");
+      BDD *vars = BDD_cube(f, "AC", NULL);
+
+      BDD *restricted = BDD_restrict(f, fixed);
+      BDD *exists = BDD_exists(f, vars);
+      BDD *forall = BDD_forall(f, vars);
+      BDD *and_exists = BDD_and_exists(f, g, vars);
+
+      char inputs[6];
+      for (int j = 0; j < (1 << num_vars); j++) {
+        int expected_exists = 0;
+        int expected_forall = 1;
+        int expected_and_exists = 0;
+
+        // A and C (bits 0 and 2) range over all four combinations
+        for (int q = 0; q < 4; q++) {
+          int k = (j & ~5) | (q & 1) | ((q & 2) << 1);
+          for (int b = 0; b < num_vars; b++) {
+            inputs[b] = ((k >> b) & 1) ? '1' : '0';
+          }
+          inputs[num_vars] = '\0';
+
+          int f_value = eval_boolean_function(f_full, inputs);
+          int g_value = eval_boolean_function(g_full, inputs);
+          expected_exists |= f_value;
+          expected_forall &= f_value;
+          expected_and_exists |= f_value & g_value;
+        }
+
+        for (int b = 0; b < num_vars; b++) {
+          inputs[b] = ((j >> b) & 1) ? '1' : '0';
+        }
+        inputs[1] = '0';
+        inputs[3] = '1';
+        int expected_restricted = eval_boolean_function(f_full, inputs);
+
+        for (int b = 0; b < num_vars; b++) {
+          inputs[b] = ((j >> b) & 1) ? '1' : '0';
+        }
+
+        if (BDD_use(restricted, inputs) != '0' + expected_restricted ||
+            BDD_use(exists, inputs) != '0' + expected_exists ||
+            BDD_use(forall, inputs) != '0' + expected_forall ||
+            BDD_use(and_exists, inputs) != '0' + expected_and_exists) {
+          printf("Error: quantification of %s, %s, inputs %s\n", f_full,
+                 g_full, inputs);
+          errors++;
+        }
+      }
+
+      BDD_free(f);
+      BDD_free(g);
+      BDD_free(fixed);
+      BDD_free(vars);
+      BDD_free(restricted);
+      BDD_free(exists);
+      BDD_free(forall);
+      BDD_free(and_exists);
+      free(f_function);
+      free(g_function);
+      free(f_full);
+      free(g_full);
+      BDD_reset_system();
+    }
+
+    printf("Quantification test completed with %d errors\n\n", errors);
+  }
+
+  // Test incremental term edits against building the edited function directly
+  {
+    int errors = 0;
+
+    for (int i = 0; i < 10; i++) {
+      char *kept = generate_random_boolean_function(6, 4);
+      char *removed = generate_random_boolean_function(6, 3);
+      char *added = generate_random_boolean_function(6, 3);
+
+      // The ABCDEF term makes every variable of the ordering occur
+      char *initial = (char *)malloc(strlen(kept) + strlen(removed) + 9);
+      char *final = (char *)malloc(strlen(kept) + strlen(added) + 9);
+      if (!initial || !final) {
+        fprintf(stderr, "Memory allocation failed for test functions\n");
+        exit(1);
+      }
+      sprintf(initial, "ABCDEF+%s+%s", kept, removed);
+      sprintf(final, "ABCDEF+%s+%s", kept, added);
+
+      init_unique_table(10000);
+      BDD *edited = BDD_create(initial, "FCADBE");
+
+      // Add the terms of one function and remove the terms of the other.
+      // The 8 initial terms fill the tree, so the first add doubles it
+      for (char *term = strtok(added, "+"); term; term = strtok(NULL, "+")) {
+        BDD_add_term(edited, term);
+      }
+      for (char *term = strtok(removed, "+"); term; term = strtok(NULL, "+")) {
+        if (BDD_remove_term(edited, term) != 0) {
+          printf("Error: failed to remove %s from %s\n", term, initial);
+          errors++;
+        }
+      }
+
+      // Both live in one unique table, so equal functions share a root
+      BDD *rebuilt = BDD_create(final, "FCADBE");
+      if (!edited || !rebuilt || edited->root != rebuilt->root ||
+          edited->size != rebuilt->size) {
+        printf("Error: edited %s does not match %s\n", initial, final);
+        errors++;
+      }
+
+      BDD_free(edited);
+      BDD_free(rebuilt);
+      free(kept);
+      free(removed);
+      free(added);
+      free(initial);
+      free(final);
+      BDD_reset_system();
+    }
+
+    printf("Term edit test completed with %d errors\n\n", errors);
+  }
+
+  // Test parallel apply against the serial build of the same functions
+  {
+    const int num_vars = 12;
+    int errors = 0;
+
+    for (int i = 0; i < 5; i++) {
+      char *function = generate_random_boolean_function(num_vars, 40);
+      char *order = generate_random_order(num_vars);
+
+      init_unique_table(10000);
+      BDD *serial = BDD_create(function, order);
+      int serial_size = serial ? serial->size : -1;
+      double serial_count = BDD_satcount(serial);
+      BDD_free(serial);
+      BDD_reset_system();
+
+      init_unique_table(10000);
+      BDD_set_threads(4);
+      BDD *parallel = BDD_create(function, order);
+      BDD_set_threads(1);
+
+      if (!parallel || parallel->size != serial_size ||
+          BDD_satcount(parallel) != serial_count) {
+        printf("Error: parallel build of %s differs\n", function);
+        errors++;
+      } else {
+        char inputs[13];
+        for (int j = 0; j < (1 << parallel->num_vars); j++) {
+          for (int k = 0; k < parallel->num_vars; k++) {
+            inputs[k] = ((j >> k) & 1) ? '1' : '0';
+          }
+          inputs[parallel->num_vars] = '\0';
+
+          if (BDD_use(parallel, inputs) !=
+              '0' + eval_boolean_function(function, inputs)) {
+            errors++;
+          }
+        }
+      }
+
+      BDD_free(parallel);
+      free(function);
+      free(order);
+      BDD_reset_system();
+    }
+
+    // Time one large OR with 1, 2, 4 and 8 threads
+    const char *wide_order = "ABCDEFGHIJKLMNOPQRSTUVWX";
+    const int wide_terms = 100;
+    char *texts[2];
+    for (int t = 0; t < 2; t++) {
+      // Short terms give the functions large BDDs
+      texts[t] = (char *)malloc(wide_terms * 6 + 1);
+      if (!texts[t]) {
+        fprintf(stderr, "Memory allocation failed for random function\n");
+        exit(1);
+      }
+      for (int j = 0; j < wide_terms; j++) {
+        for (int k = 0; k < 5; k++) {
+          texts[t][6 * j + k] = 'A' + rand() % 24;
+        }
+        texts[t][6 * j + 5] = '+';
+      }
+      texts[t][wide_terms * 6 - 1] = '\0';
+    }
+    char *f_text = texts[0];
+    char *g_text = texts[1];
+    const int runs = 4;
+    int sizes[4];
+    double seconds[4];
+    for (int run = 0; run < runs; run++) {
+      init_unique_table(10000);
+      BDD *f = BDD_create(f_text, wide_order);
+      BDD *g = BDD_create(g_text, wide_order);
+      BDD_set_threads(1 << run);
+
+      struct timespec start, end;
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      Node *result = (f && g) ? apply_or(f->root, g->root) : NULL;
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      BDD_set_threads(1);
+
+      seconds[run] =
+          (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+      sizes[run] = result ? subgraph_size(result) : -1;
+      BDD_free(f);
+      BDD_free(g);
+      BDD_reset_system();
+    }
+    printf("Large OR on %ld online cores:\n", sysconf(_SC_NPROCESSORS_ONLN));
+    for (int run = 0; run < runs; run++) {
+      if (sizes[run] < 0 || sizes[run] != sizes[0]) {
+        printf("Error: OR with %d threads differs from the serial one\n",
+               1 << run);
+        errors++;
+      }
+      printf("  %d thread%s: %.3fs (speedup %.2f)\n", 1 << run,
+             run > 0 ? "s" : "", seconds[run], seconds[0] / seconds[run]);
+    }
+    free(f_text);
+    free(g_text);
+
+    printf("Parallel apply test completed with %d errors\n\n", errors);
+  }
+
+  // Test breadth-first apply against depth-first apply
+  {
+    const int num_vars = 10;
+    int errors = 0;
+
+    for (int i = 0; i < 10; i++) {
+      char *f_function = generate_random_boolean_function(num_vars, 8);
+      char *g_function = generate_random_boolean_function(num_vars, 8);
+
+      init_unique_table(10000);
+      BDD *f = BDD_create(f_function, "ABCDEFGHIJ");
+      BDD *g = BDD_create(g_function, "ABCDEFGHIJ");
+
+      // Every other run spills all finished levels to the temporary file
+      BDD_set_breadth_first_memory(i % 2 ? 1 : 1000000);
+      for (int op = OP_OR; op <= OP_AND; op++) {
+        BDD *breadth_first = BDD_apply_breadth_first(f, g, op);
+
+        // Clear the cache so depth-first apply cannot reuse its results
+        init_computed_table(computed_table.size);
+        Node *expected = op == OP_OR ? apply_or(f->root, g->root)
+                                     : apply_and(f->root, g->root);
+
+        if (!breadth_first || breadth_first->root != expected) {
+          printf("Error: breadth-first %s of %s and %s differs\n",
+                 op == OP_OR ? "OR" : "AND", f_function, g_function);
+          errors++;
+        }
+        BDD_free(breadth_first);
+      }
+      BDD_set_breadth_first_memory(1000000);
+
+      BDD_free(f);
+      BDD_free(g);
+      free(f_function);
+      free(g_function);
+      BDD_reset_system();
+    }
+
+    printf("Breadth-first apply test completed with %d errors\n\n", errors);
+  }
+
+  // Test the node budget and the size-capped approximations
+  {
+    const int num_vars = 10;
+    int errors = 0;
+
+    for (int i = 0; i < 10; i++) {
+      char *function = generate_random_boolean_function(num_vars, 15);
+
+      init_unique_table(10000);
+      BDD *bdd = BDD_create(function, "ABCDEFGHIJ");
+      if (!bdd) {
+        free(function);
+        BDD_reset_system();
+        continue;
+      }
+
+      for (int method = APPROX_HEAVY_BRANCH; method <= APPROX_REMAP;
+           method++) {
+        for (int over = 0; over <= 1; over++) {
+          double retained = 0;
+          int max_nodes = bdd->size / 2;
+          BDD *approximation =
+              BDD_approximate(bdd, method, max_nodes, over, &retained);
+
+          if (!approximation || approximation->size > max_nodes ||
+              retained < 0 || retained > 1) {
+            printf("Error: approximation %d/%d of %s failed\n", method, over,
+                   function);
+            errors++;
+            BDD_free(approximation);
+            continue;
+          }
+
+          // A subset may only lose ones, a superset may only gain them
+          char inputs[11];
+          for (int j = 0; j < (1 << num_vars); j++) {
+            for (int k = 0; k < num_vars; k++) {
+              inputs[k] = ((j >> k) & 1) ? '1' : '0';
+            }
+            inputs[num_vars] = '\0';
+
+            char exact = BDD_use(bdd, inputs);
+            char approximate = BDD_use(approximation, inputs);
+            if (exact != approximate && approximate == (over ? '0' : '1')) {
+              printf("Error: approximation %d/%d of %s, inputs %s\n", method,
+                     over, function, inputs);
+              errors++;
+            }
+          }
+          BDD_free(approximation);
+        }
+      }
+
+      // Over budget, building and editing fail without touching the BDD
+      Node *root = bdd->root;
+      BDD_set_node_limit(unique_table.count);
+      BDD *rebuilt = BDD_create("AB+CD+EF+GH+IJ+ACEGI+BDFHJ", "ABCDEFGHIJ");
+      BDD_add_term(bdd, "ABCDEFGHIJ");
+      if (rebuilt != NULL || bdd->root != root) {
+        printf("Error: node limit not enforced for %s\n", function);
+        errors++;
+      }
+      BDD_set_node_limit(0);
+
+      BDD_free(rebuilt);
+      BDD_free(bdd);
+      free(function);
+      BDD_reset_system();
+    }
+
+    printf("Approximation test completed with %d errors\n\n", errors);
+  }
+
+  // Test function fingerprints and the persistent ordering cache
+  {
+    int errors = 0;
+
+    if (BDD_fingerprint("AB+C") != BDD_fingerprint("c+BA+AB") ||
+        BDD_fingerprint("AB+C") == BDD_fingerprint("AB+D") ||
+        BDD_fingerprint("AB+C") == BDD_fingerprint("ABC")) {
+      printf("Error: fingerprints do not follow the term set\n");
+      errors++;
+    }
+
+    char cache_path[64];
+    char lock_path[80];
+    sprintf(cache_path, "bdd_order_cache_%ld.txt", (long)getpid());
+    sprintf(lock_path, "%s.lock", cache_path);
+    BDD_set_order_cache(cache_path, 3);
+
+    char *function = generate_random_boolean_function(8, 6);
+    strcat(function, "+ABCDEFGH");
+    unsigned long long fingerprint = BDD_fingerprint(function);
+
+    int sizes[3];
+    for (int run = 0; run < 3; run++) {
+      init_unique_table(10000);
+      BDD *bdd = BDD_create_with_best_order(function);
+      sizes[run] = bdd ? bdd->size : -1;
+      BDD_free(bdd);
+      BDD_reset_system();
+    }
+
+    // The first run searches 8 orders, each later one 3 more around the best
+    OrderCacheEntry entry;
+    if (!order_cache_lookup(fingerprint, &entry) || entry.tries != 8 + 3 + 3 ||
+        entry.size != sizes[2] || sizes[1] > sizes[0] ||
+        sizes[2] > sizes[1]) {
+      printf("Error: ordering cache for %s not reused\n", function);
+      errors++;
+    }
+
+    // A line that does not parse must not cost the entries after it
+    FILE *file = fopen(cache_path, "w");
+    if (file) {
+      fprintf(file, "0000000000000001 AB 1 1\n");
+      fprintf(file, "garbage left by a crashed writer\n");
+      fprintf(file, "0000000000000002 AB 2 1\n");
+      fprintf(file, "0000000000000003 AB 3 1\n");
+      fclose(file);
+    }
+    order_cache_store(4, "AB", 4, 1);
+    for (unsigned long long key = 1; key <= 4; key++) {
+      if (!order_cache_lookup(key, &entry) || entry.size != (int)key) {
+        printf("Error: ordering cache entry %llu lost\n", key);
+        errors++;
+      }
+    }
+
+    BDD_set_order_cache(NULL, 0);
+    remove(cache_path);
+    remove(lock_path);
+    free(function);
+
+    printf("Ordering cache test completed with %d errors\n\n", errors);
+  }
+
+  // Test the ZDD engine against the BDD operations
+  {
+    int errors = 0;
+    const char *order = "ABCDEFGH";
+
+    for (int i = 0; i < 10; i++) {
+      // Both functions use all eight variables, so their sets of satisfying
+      // assignments range over the same variables
+      char *f_text = generate_random_boolean_function(8, 4);
+      char *g_text = generate_random_boolean_function(8, 4);
+      strcat(f_text, "+ABCDEFGH");
+      strcat(g_text, "+ABCDEFGH");
+
+      init_unique_table(10000);
+      BDD *f = BDD_create(f_text, order);
+      BDD *g = BDD_create(g_text, order);
+      ZDD *f_cover = ZDD_create(f_text, order);
+      ZDD *g_cover = ZDD_create(g_text, order);
+      if (!f || !g || !f_cover || !g_cover) {
+        printf("Error: ZDD inputs for %s and %s not built\n", f_text, g_text);
+        errors++;
+        BDD_free(f);
+        BDD_free(g);
+        ZDD_free(f_cover);
+        ZDD_free(g_cover);
+        BDD_reset_system();
+        free(f_text);
+        free(g_text);
+        continue;
+      }
+
+      // Covers - the union and the product are the OR and the AND
+      ZDD *sum = ZDD_union(f_cover, g_cover);
+      ZDD *product = ZDD_product(f_cover, g_cover);
+      BDD *sum_bdd = BDD_from_zdd_cover(sum);
+      BDD *product_bdd = BDD_from_zdd_cover(product);
+      BDD *f_back = BDD_from_zdd_cover(f_cover);
+      if (!sum_bdd || !product_bdd || !f_back ||
+          sum_bdd->root != apply_or(f->root, g->root) ||
+          product_bdd->root != apply_and(f->root, g->root) ||
+          f_back->root != f->root) {
+        printf("Error: ZDD covers of %s and %s do not match\n", f_text,
+               g_text);
+        errors++;
+      }
+
+      // Sets of satisfying assignments - every set operation matches the
+      // corresponding Boolean one
+      ZDD *f_sets = ZDD_from_bdd(f);
+      ZDD *g_sets = ZDD_from_bdd(g);
+      ZDD *both = ZDD_intersect(f_sets, g_sets);
+      ZDD *either = ZDD_union(f_sets, g_sets);
+      ZDD *only_f = ZDD_difference(f_sets, g_sets);
+      Node *not_g = run_operation(OP_NOT, g->root, NULL, NULL);
+      BDD *only_f_bdd = make_bdd(apply_and(f->root, not_g), f->num_vars,
+                                 f->var_order);
+      ZDD *expected = ZDD_from_bdd(only_f_bdd);
+      BDD *f_sets_back = BDD_from_zdd(f_sets);
+      BDD *both_bdd = BDD_from_zdd(both);
+      BDD *either_bdd = BDD_from_zdd(either);
+      if (!expected || !f_sets_back || !both_bdd || !either_bdd ||
+          only_f->root != expected->root || f_sets_back->root != f->root ||
+          both_bdd->root != apply_and(f->root, g->root) ||
+          either_bdd->root != apply_or(f->root, g->root)) {
+        printf("Error: ZDD set operations on %s and %s do not match\n",
+               f_text, g_text);
+        errors++;
+      }
+
+      BDD_free(f);
+      BDD_free(g);
+      BDD_free(sum_bdd);
+      BDD_free(product_bdd);
+      BDD_free(f_back);
+      BDD_free(only_f_bdd);
+      BDD_free(f_sets_back);
+      BDD_free(both_bdd);
+      BDD_free(either_bdd);
+      ZDD_free(f_cover);
+      ZDD_free(g_cover);
+      ZDD_free(sum);
+      ZDD_free(product);
+      ZDD_free(f_sets);
+      ZDD_free(g_sets);
+      ZDD_free(both);
+      ZDD_free(either);
+      ZDD_free(only_f);
+      ZDD_free(expected);
+      BDD_reset_system();
+      free(f_text);
+      free(g_text);
+    }
+
+    // A sparse cover needs one node per literal at most, its BDD far more
+    init_unique_table(10000);
+    const char *sparse = "AN+BO+CP+DQ+ER+FS+GT+HU+IV+JW+KX+LY+MZ";
+    const char *sparse_order = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    BDD *sparse_bdd = BDD_create(sparse, sparse_order);
+    ZDD *sparse_zdd = ZDD_create(sparse, sparse_order);
+    if (!sparse_bdd || !sparse_zdd || sparse_zdd->size > 26 ||
+        sparse_zdd->size >= sparse_bdd->size) {
+      printf("Error: sparse cover ZDD not smaller than its BDD\n");
+      errors++;
+    } else {
+      printf("Sparse cover: %d ZDD nodes, %d BDD nodes\n", sparse_zdd->size,
+             sparse_bdd->size);
+    }
+    BDD_free(sparse_bdd);
+    ZDD_free(sparse_zdd);
+    BDD_reset_system();
+
+    printf("ZDD test completed with %d errors\n\n", errors);
+  }
+
   // Number of variables to test (max 13 as per assignment)
   const int max_vars =
       6; // Reduced for testing, increase up to 13 for final version
@@ -759,6 +4728,7 @@ void test_bdd() {
 
       // Verify the BDD produces correct results
       int bdd_errors = 0;
+      int expected_ones = 0;
       for (int j = 0; j < (1 << num_vars); j++) {
         char *inputs = (char *)malloc(num_vars + 1);
         if (!inputs) {
@@ -773,6 +4743,7 @@ void test_bdd() {
 
         int expected = eval_boolean_function(function, inputs);
         char expected_char = expected ? '1' : '0';
+        expected_ones += expected;
 
         char result_best = BDD_use(bdd_best, inputs);
 
@@ -785,6 +4756,51 @@ void test_bdd() {
         free(inputs);
       }
 
+      // Verify counting, sampling and enumeration against the truth table
+      // (the BDD only spans the variables that occur in the function)
+      expected_ones >>= num_vars - bdd_best->num_vars;
+      if (BDD_satcount(bdd_best) != expected_ones) {
+        printf("Error: Function %s, satcount %.0f, expected %d\n", function,
+               BDD_satcount(bdd_best), expected_ones);
+        bdd_errors++;
+      }
+
+      char *assignment = (char *)malloc(bdd_best->num_vars + 1);
+      if (!assignment) {
+        fprintf(stderr, "Memory allocation failed for assignment\n");
+        exit(1);
+      }
+
+      BDDSampler *sampler = BDD_sampler_create(bdd_best);
+      for (int j = 0; j < 20; j++) {
+        if (BDD_sampler_next(sampler, assignment) == 1 &&
+            BDD_use(bdd_best, assignment) != '1') {
+          printf("Error: Function %s, sampled non-solution %s\n", function,
+                 assignment);
+          bdd_errors++;
+        }
+      }
+      BDD_sampler_free(sampler);
+
+      int enumerated = 0;
+      BDDCursor *cursor = BDD_cursor_create(bdd_best);
+      while (BDD_cursor_next(cursor, assignment) == 1) {
+        enumerated++;
+        if (BDD_use(bdd_best, assignment) != '1') {
+          printf("Error: Function %s, enumerated non-solution %s\n", function,
+                 assignment);
+          bdd_errors++;
+        }
+      }
+      BDD_cursor_free(cursor);
+      free(assignment);
+
+      if (enumerated != expected_ones) {
+        printf("Error: Function %s, enumerated %d, expected %d\n", function,
+               enumerated, expected_ones);
+        bdd_errors++;
+      }
+
       if (bdd_errors > 0) {
         printf("Function %s had %d evaluation errors\n", function, bdd_errors);
       }
@@ -815,6 +4831,8 @@ int main() {
   unique_table.buckets = NULL;
   unique_table.size = 0;
   unique_table.count = 0;
+  computed_table.entries = NULL;
+  computed_table.size = 0;
   zero_terminal = NULL;
   one_terminal = NULL;
 
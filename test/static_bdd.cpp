@@ -0,0 +1,95 @@
+// Tests of the compile-time BDDs in src/static_bdd.hpp
+
+#include "../src/static_bdd.hpp"
+#include <stdio.h>
+#include <string.h>
+
+// Evaluate a Boolean function for a given input (as in main.c)
+int eval_boolean_function(const char *bfunkcia, const char *inputs) {
+  int result = 0;
+  int i = 0;
+
+  while (bfunkcia[i] != '\0') {
+    int term_result = 1;
+
+    // Process one product term
+    while (bfunkcia[i] != '\0' && bfunkcia[i] != '+') {
+      int var_idx = -1;
+      if (bfunkcia[i] >= 'A' && bfunkcia[i] <= 'Z') {
+        var_idx = bfunkcia[i] - 'A';
+      } else if (bfunkcia[i] >= 'a' && bfunkcia[i] <= 'z') {
+        var_idx = bfunkcia[i] - 'a';
+      }
+      if (var_idx >= 0 && var_idx < (int)strlen(inputs)) {
+        term_result &= inputs[var_idx] - '0';
+      }
+      i++;
+    }
+
+    result |= term_result;
+
+    // Skip the '+' separator
+    if (bfunkcia[i] == '+') {
+      i++;
+    }
+  }
+
+  return result;
+}
+
+// Compare a static BDD with the function on every input
+template <int Capacity>
+int check_function(const static_bdd::BDD<Capacity> &bdd,
+                   const char *bfunkcia) {
+  int errors = 0;
+  char inputs[27] = {};
+
+  for (int mask = 0; mask < (1 << bdd.num_vars); mask++) {
+    for (int v = 0; v < bdd.num_vars; v++) {
+      inputs[v] = (mask >> v) & 1 ? '1' : '0';
+    }
+    char expected = '0' + eval_boolean_function(bfunkcia, inputs);
+    if (static_bdd::BDD_use(bdd, inputs) != expected) {
+      printf("Error: static BDD of %s wrong for input %s\n", bfunkcia,
+             inputs);
+      errors++;
+    }
+  }
+
+  return errors;
+}
+
+// Built during compilation - the node counts are checked by the compiler
+constexpr auto majority_built =
+    static_bdd::BDD_create<32>("AB+AC+BC", "ABC");
+constexpr auto majority =
+    static_bdd::BDD_freeze<majority_built.count>(majority_built);
+static_assert(majority.size == 4, "Majority of three has four nodes");
+static_assert(static_bdd::BDD_use(majority, "110") == '1', "");
+static_assert(static_bdd::BDD_use(majority, "100") == '0', "");
+static_assert(static_bdd::BDD_use(majority, "1x0") == -1, "");
+
+// The ordering decides the size, as for runtime BDDs
+constexpr auto pairs_good = static_bdd::BDD_create<64>("AB+CD+EF", "ABCDEF");
+constexpr auto pairs_bad = static_bdd::BDD_create<64>("AB+CD+EF", "ACEBDF");
+static_assert(pairs_good.size == 6, "");
+static_assert(pairs_bad.size > pairs_good.size, "");
+
+// Constant functions
+constexpr auto empty = static_bdd::BDD_create<2>("", "");
+static_assert(empty.size == 0 && static_bdd::BDD_use(empty, "") == '0', "");
+
+int main() {
+  int errors = 0;
+
+  errors += check_function(majority, "AB+AC+BC");
+  errors += check_function(pairs_good, "AB+CD+EF");
+  errors += check_function(pairs_bad, "AB+CD+EF");
+
+  constexpr auto mixed =
+      static_bdd::BDD_create<128>("Ab+bCd+aDE+cF+ABCDEF", "FEDCBA");
+  errors += check_function(mixed, "Ab+bCd+aDE+cF+ABCDEF");
+
+  printf("Static BDD test completed with %d errors\n", errors);
+  return errors != 0;
+}